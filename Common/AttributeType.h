@@ -10,6 +10,12 @@ enum class AttributeType : uint8_t
 	vec2,
 	float32,
 	uint32,
+	half2,			//16 bit floats, for UVs
+	octahedral16,	//unit vector folded onto an octahedron and stored as two snorm16s, needs decoding in the shader
+	unorm8x4,		//for colors, the fourth channel is unused
+	unorm16x4,		//positions quantised inside the mesh bounds, see OFile::FileData::positionOffset; the fourth channel is unused
+	vec4,			//for tangents, w holds the sign of the bitangent
+	snorm8x4,		//compact tangents, w holds the sign of the bitangent
 };
 
 [[nodiscard]]
@@ -29,6 +35,25 @@ inline VkFormat attributeTypeToFormat(const AttributeType attributeType)
 	case AttributeType::uint32:
 		return VK_FORMAT_R32_UINT;
 		break;
+	case AttributeType::half2:
+		return VK_FORMAT_R16G16_SFLOAT;
+		break;
+	case AttributeType::octahedral16:
+		return VK_FORMAT_R16G16_SNORM;
+		break;
+	case AttributeType::unorm8x4:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+		break;
+	case AttributeType::unorm16x4:
+		//three channel 16 bit formats are rarely supported as vertex inputs
+		return VK_FORMAT_R16G16B16A16_UNORM;
+		break;
+	case AttributeType::vec4:
+		return VK_FORMAT_R32G32B32A32_SFLOAT;
+		break;
+	case AttributeType::snorm8x4:
+		return VK_FORMAT_R8G8B8A8_SNORM;
+		break;
 	default:
 		assert(false);
 		return VK_FORMAT_UNDEFINED;
@@ -53,6 +78,20 @@ inline size_t attributeTypeToSize(const AttributeType attributeType)
 	case AttributeType::uint32:
 		return sizeof(uint32_t);
 		break;
+	case AttributeType::half2:
+	case AttributeType::octahedral16:
+		return sizeof(uint16_t) * 2;
+		break;
+	case AttributeType::unorm8x4:
+	case AttributeType::snorm8x4:
+		return sizeof(uint8_t) * 4;
+		break;
+	case AttributeType::unorm16x4:
+		return sizeof(uint16_t) * 4;
+		break;
+	case AttributeType::vec4:
+		return sizeof(vec4);
+		break;
 	default:
 		assert(false);
 		return 0;
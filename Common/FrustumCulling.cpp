@@ -0,0 +1,129 @@
+#include "FrustumCulling.h"
+#include <bit>
+#include <immintrin.h>
+
+namespace
+{
+	//same order of operations as the simd versions, so both give exactly the same answer
+	bool insideAll(const FrustumPlanes &planes, float x, float y, float z, float radius)
+	{
+		for (const vec4 &plane : planes)
+		{
+			const float distance = ((x * plane.x() + y * plane.y()) + z * plane.z()) + plane.w();
+			if (!(distance >= -radius)) return false;
+		}
+		return true;
+	}
+
+	//one bit per sphere from a movemask, lowest first
+	void appendVisible(uint32_t mask, uint32_t first, std::vector<uint32_t> &visible)
+	{
+		while (mask != 0)
+		{
+			visible.push_back(first + static_cast<uint32_t>(std::countr_zero(mask)));
+			mask &= mask - 1;
+		}
+	}
+}
+
+FrustumPlanes extractFrustumPlanes(const mat4x4 &viewProjection)
+{
+	const auto row = [&](size_t y) { return vec4(viewProjection.at(0, y), viewProjection.at(1, y), viewProjection.at(2, y), viewProjection.at(3, y)); };
+	FrustumPlanes planes = { row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(2), row(3) - row(2) };
+	for (vec4 &plane : planes)
+	{
+		plane = plane / plane.xyz().length();
+	}
+	return planes;
+}
+
+void SphereBatch::clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	radius.clear();
+}
+
+void SphereBatch::reserve(size_t count)
+{
+	x.reserve(count);
+	y.reserve(count);
+	z.reserve(count);
+	radius.reserve(count);
+}
+
+void SphereBatch::push(vec3 center, float sphereRadius)
+{
+	x.push_back(center.x());
+	y.push_back(center.y());
+	z.push_back(center.z());
+	radius.push_back(sphereRadius);
+}
+
+void cullSpheres(const FrustumPlanes &planes, const SphereBatch &spheres, std::vector<uint32_t> &visible)
+{
+	const size_t count = spheres.size();
+	visible.reserve(visible.size() + count);
+	size_t i = 0;
+
+#if defined(__AVX__)
+	std::array<std::array<__m256, 4>, 6> planeComponents;
+	for (size_t p = 0; p < planes.size(); p++)
+	{
+		planeComponents[p] = { _mm256_set1_ps(planes[p].x()), _mm256_set1_ps(planes[p].y()), _mm256_set1_ps(planes[p].z()), _mm256_set1_ps(planes[p].w()) };
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(spheres.x.data() + i);
+		const __m256 y = _mm256_loadu_ps(spheres.y.data() + i);
+		const __m256 z = _mm256_loadu_ps(spheres.z.data() + i);
+		const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius.data() + i));
+
+		__m256 inside = _mm256_cmp_ps(negativeRadius, negativeRadius, _CMP_EQ_OQ);
+		for (const std::array<__m256, 4> &plane : planeComponents)
+		{
+			const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, plane[0]), _mm256_mul_ps(y, plane[1])), _mm256_mul_ps(z, plane[2])), plane[3]);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+		appendVisible(static_cast<uint32_t>(_mm256_movemask_ps(inside)), static_cast<uint32_t>(i), visible);
+	}
+#else
+	std::array<std::array<__m128, 4>, 6> planeComponents;
+	for (size_t p = 0; p < planes.size(); p++)
+	{
+		planeComponents[p] = { _mm_set1_ps(planes[p].x()), _mm_set1_ps(planes[p].y()), _mm_set1_ps(planes[p].z()), _mm_set1_ps(planes[p].w()) };
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(spheres.x.data() + i);
+		const __m128 y = _mm_loadu_ps(spheres.y.data() + i);
+		const __m128 z = _mm_loadu_ps(spheres.z.data() + i);
+		const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + i));
+
+		__m128 inside = _mm_cmpeq_ps(negativeRadius, negativeRadius);
+		for (const std::array<__m128, 4> &plane : planeComponents)
+		{
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, plane[0]), _mm_mul_ps(y, plane[1])), _mm_mul_ps(z, plane[2])), plane[3]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+		appendVisible(static_cast<uint32_t>(_mm_movemask_ps(inside)), static_cast<uint32_t>(i), visible);
+	}
+#endif
+
+	//the last few that don't fill a register
+	for (; i < count; i++)
+	{
+		if (insideAll(planes, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i])) visible.push_back(static_cast<uint32_t>(i));
+	}
+}
+
+void cullSpheresScalar(const FrustumPlanes &planes, const SphereBatch &spheres, std::vector<uint32_t> &visible)
+{
+	for (size_t i = 0; i < spheres.size(); i++)
+	{
+		if (insideAll(planes, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i])) visible.push_back(static_cast<uint32_t>(i));
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <mat.h>
+#include <vec.h>
+
+//normalised planes pointing inwards: left, right, bottom, top, near and far
+using FrustumPlanes = std::array<vec4, 6>;
+
+//the planes the clip space volume (-w <= x, y <= w, 0 <= z <= w) makes in the space viewProjection transforms from
+[[nodiscard]]
+FrustumPlanes extractFrustumPlanes(const mat4x4 &viewProjection);
+
+//world space bounding spheres with one array per component, so the planes can be tested against several of them at once
+struct SphereBatch
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+
+	size_t size() const { return x.size(); }
+	void clear();
+	void reserve(size_t count);
+	void push(vec3 center, float sphereRadius);
+};
+
+//appends the index of every sphere that is at least partly inside all six planes to visible, in order
+//tests eight spheres at a time with avx when it's compiled with it and four with sse otherwise
+void cullSpheres(const FrustumPlanes &planes, const SphereBatch &spheres, std::vector<uint32_t> &visible);
+
+//the same test one sphere at a time, to check the simd version against
+void cullSpheresScalar(const FrustumPlanes &planes, const SphereBatch &spheres, std::vector<uint32_t> &visible);
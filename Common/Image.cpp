@@ -4,61 +4,92 @@
 #include <stb_image.h>
 #include <Logger/Logger.h>
 #include "VkInitializers.h"
+#include "TextureSerialization.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
 
-std::optional<AllocatedImage> vkut::loadImageFromFile(ImageLoadContext context, const char *filePath)
+namespace
 {
-	int texWidth, texHeight, texChannels;
-
-	stbi_uc *pixels = stbi_load(filePath, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-
-	if (!pixels) {
-		return std::nullopt;
+	uint32_t fullMipChainLength(VkExtent3D extent)
+	{
+		return std::bit_width(std::max(extent.width, extent.height));
 	}
 
-	const size_t pixelNumber = texWidth * texHeight;
-	const VkDeviceSize imageSize = pixelNumber * 4U;
+	//blitting a level down from the one above with a linear filter needs the format to support all three, which isn't guaranteed
+	bool canGenerateMips(VkPhysicalDevice physicalDevice, VkFormat format)
+	{
+		constexpr VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
 
-	const VkFormat imageFormat = VK_FORMAT_R8G8B8A8_SRGB; //this matches exactly with the pixels loaded from stb_image lib
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+		return (properties.optimalTilingFeatures & required) == required;
+	}
 
-	//allocate temporary buffer for holding texture data to upload
-	AllocatedBuffer stagingBuffer = vkmem::createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, context.allocator, VMA_MEMORY_USAGE_CPU_ONLY);
-	vkmem::uploadToBuffer<stbi_uc>({ .data = pixels, .buffer = stagingBuffer, .size = imageSize });
-	
-	stbi_image_free(pixels); //pixel data is now in the staging buffer
-	pixels = nullptr;
+	VkImageMemoryBarrier mipBarrier(VkImage image, uint32_t mipLevel, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkImageLayout oldLayout, VkImageLayout newLayout)
+	{
+		return VkImageMemoryBarrier
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = srcAccessMask,
+			.dstAccessMask = dstAccessMask,
+			.oldLayout = oldLayout,
+			.newLayout = newLayout,
+			.image = image,
+			.subresourceRange = 
+			{ 
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, 
+				.baseMipLevel = mipLevel, 
+				.levelCount = 1, 
+				.layerCount = 1 
+			}
+		};
+	}
 
-	const VkExtent3D imageExtent
+	//each level is blitted down from the one above it, which is then done being written and can go to the shader readable layout
+	void recordMipBlits(VkCommandBuffer cmd, VkImage image, VkExtent3D extent, uint32_t firstGeneratedLevel, uint32_t mipLevels)
 	{
-		.width = static_cast<uint32_t>(texWidth),
-		.height = static_cast<uint32_t>(texHeight),
-		.depth = 1
-	};
+		for (uint32_t level = firstGeneratedLevel; level < mipLevels; level++)
+		{
+			const int32_t sourceWidth = std::max(1, int32_t(extent.width >> (level - 1)));
+			const int32_t sourceHeight = std::max(1, int32_t(extent.height >> (level - 1)));
 
-	const VkImageCreateInfo imageCreateInfo = vkinit::imageCreateInfo(imageFormat, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
+			const VkImageMemoryBarrier toSource = mipBarrier(image, level - 1, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toSource);
 
-	const VmaAllocationCreateInfo imageAllocationInfo
-	{ 
-		.usage = VMA_MEMORY_USAGE_GPU_ONLY
-	};
+			const VkImageBlit blit
+			{
+				.srcSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level - 1, .layerCount = 1 },
+				.srcOffsets = { {}, { sourceWidth, sourceHeight, 1 } },
+				.dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1 },
+				.dstOffsets = { {}, { std::max(1, sourceWidth / 2), std::max(1, sourceHeight / 2), 1 } }
+			};
+			vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
-	AllocatedImage newImage;
-	VK_CHECK(vkmem::createImage(context.allocator, imageCreateInfo, imageAllocationInfo, newImage, nullptr));
+			const VkImageMemoryBarrier toReadable = mipBarrier(image, level - 1, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toReadable);
+		}
+	}
 
-	const vkut::UploadContext uploadContext
+	//what to create for one image and which parts of the shared staging buffer go into it
+	struct ImageUpload
 	{
-		.device = context.device,
-		.uploadFence = context.uploadFence,
-		.commandPool = context.uploadCommandPool,
-		.queue = context.queue
+		VkFormat format;
+		VkExtent3D extent;
+		std::vector<VkBufferImageCopy> copyRegions; //one per mip level copied from staging, starting at level 0
+		uint32_t mipLevels; //levels past the copied ones are generated on the gpu by blitting down from the last copied level
 	};
 
-	vkut::submitCommand(uploadContext, [=](VkCommandBuffer cmd) 
+	void recordImageUpload(VkCommandBuffer cmd, VkBuffer stagingBuffer, VkImage image, const ImageUpload &upload)
 	{
+		const uint32_t copiedLevels = (uint32_t)upload.copyRegions.size();
+
 		const VkImageSubresourceRange range
 		{
 			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
 			//base MipLevel and ArrayLayer are 0
-			.levelCount = 1,
+			.levelCount = upload.mipLevels,
 			.layerCount = 1
 		};
 
@@ -69,29 +100,16 @@ std::optional<AllocatedImage> vkut::loadImageFromFile(ImageLoadContext context,
 			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
 			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
 			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			.image = newImage.image,
+			.image = image,
 			.subresourceRange = range,
 		};
 
 		//barrier the image into the transfer-receive layout
 		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrierToTransfer);
 
-		const VkBufferImageCopy copyRegion 
-		{
-			//buffer Offset, RowLength and ImageHeight are 0
-			.imageSubresource = 
-			{
-				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-				//mipLevel is 0
-				//base array layer is 0
-				.layerCount = 1,
-			},
-			.imageExtent = imageExtent
-		};
-
-		vkCmdCopyBufferToImage(cmd, stagingBuffer.buffer, newImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+		vkCmdCopyBufferToImage(cmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copiedLevels, upload.copyRegions.data());
 
-		const VkImageMemoryBarrier imageBarrierToReadable
+		VkImageMemoryBarrier imageBarrierToReadable
 		{
 			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
 			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
@@ -102,10 +120,244 @@ std::optional<AllocatedImage> vkut::loadImageFromFile(ImageLoadContext context,
 			.subresourceRange = imageBarrierToTransfer.subresourceRange,
 		};
 
+		if (upload.mipLevels > copiedLevels)
+		{
+			//the blits move every level but the last one to the readable layout themselves
+			recordMipBlits(cmd, image, upload.extent, copiedLevels, upload.mipLevels);
+			imageBarrierToReadable.subresourceRange.baseMipLevel = upload.mipLevels - 1;
+			imageBarrierToReadable.subresourceRange.levelCount = 1;
+		}
+
 		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrierToReadable); //image will be in the shader readable layout
-	});
+	}
+
+	//creates every image and records all of their copies, barriers and blits into a single submission, leaving them ready to be sampled
+	std::vector<vkut::LoadedImage> uploadImages(const vkut::ImageLoadContext &context, const AllocatedBuffer &stagingBuffer, const std::vector<ImageUpload> &uploads)
+	{
+		const VmaAllocationCreateInfo imageAllocationInfo
+		{ 
+			.usage = VMA_MEMORY_USAGE_GPU_ONLY
+		};
+
+		std::vector<vkut::LoadedImage> images;
+		images.reserve(uploads.size());
+		for (const ImageUpload &upload : uploads)
+		{
+			const bool generatesMips = upload.mipLevels > upload.copyRegions.size();
+			VkImageCreateInfo imageCreateInfo = vkinit::imageCreateInfo(upload.format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | (generatesMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0), upload.extent);
+			imageCreateInfo.mipLevels = upload.mipLevels;
+
+			AllocatedImage newImage;
+			VK_CHECK(vkmem::createImage(context.allocator, imageCreateInfo, imageAllocationInfo, newImage, nullptr));
+			images.push_back(vkut::LoadedImage{ .image = newImage, .format = upload.format, .mipLevels = upload.mipLevels });
+		}
+
+		const vkut::UploadContext uploadContext
+		{
+			.device = context.device,
+			.uploadFence = context.uploadFence,
+			.commandPool = context.uploadCommandPool,
+			.queue = context.queue
+		};
+
+		vkut::submitCommand(uploadContext, [&](VkCommandBuffer cmd) 
+		{
+			for (size_t i = 0; i < uploads.size(); i++)
+			{
+				recordImageUpload(cmd, stagingBuffer.buffer, images[i].image.image, uploads[i]);
+			}
+		});
+
+		return images;
+	}
+
+	//decoded images are only held until they're copied into staging, so a batch's staging buffer is capped rather than every image's pixels
+	constexpr VkDeviceSize maxBatchStagingBytes = 256ULL * 1024 * 1024;
+
+	struct ImageInfo
+	{
+		int width = 0;
+		int height = 0;
+		VkDeviceSize bytes() const { return VkDeviceSize(width) * VkDeviceSize(height) * 4U; }
+	};
+
+	//decodes the images straight into one staging buffer across the pool and uploads them together
+	void loadImageBatch(const vkut::ImageLoadContext &context, std::span<const char *const> filePaths, std::span<const ImageInfo> infos, std::span<std::optional<vkut::LoadedImage>> results, ThreadPool *pool)
+	{
+		std::vector<VkDeviceSize> offsets(infos.size());
+		VkDeviceSize stagingBytes = 0;
+		for (size_t i = 0; i < infos.size(); i++)
+		{
+			offsets[i] = stagingBytes;
+			stagingBytes += infos[i].bytes(); //rgba8 keeps every offset a multiple of the texel size, as copies require
+		}
+		if (stagingBytes == 0) return;
+
+		AllocatedBuffer stagingBuffer = vkmem::createBuffer(stagingBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, context.allocator, VMA_MEMORY_USAGE_CPU_ONLY);
+		std::byte *stagingData = static_cast<std::byte *>(vkmem::getMappedData(stagingBuffer));
+
+		std::vector<uint8_t> decoded(infos.size(), false);
+		auto decode = [&](size_t i)
+		{
+			if (infos[i].bytes() == 0) return;
+
+			int texWidth, texHeight, texChannels;
+			stbi_uc *pixels = stbi_load(filePaths[i], &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+			if (!pixels) return;
+
+			//the file could have changed since its header was read
+			if (texWidth == infos[i].width && texHeight == infos[i].height)
+			{
+				memcpy(stagingData + offsets[i], pixels, infos[i].bytes());
+				decoded[i] = true;
+			}
+			stbi_image_free(pixels); //pixel data is now in the staging buffer
+		};
+
+		if (pool != nullptr)
+		{
+			pool->parallelFor(infos.size(), decode);
+		}
+		else
+		{
+			for (size_t i = 0; i < infos.size(); i++) decode(i);
+		}
+
+		const VkFormat imageFormat = VK_FORMAT_R8G8B8A8_SRGB; //this matches exactly with the pixels loaded from stb_image lib
+		const bool generateMips = canGenerateMips(context.physicalDevice, imageFormat);
+
+		std::vector<ImageUpload> uploads;
+		std::vector<size_t> uploadedIndices;
+		for (size_t i = 0; i < infos.size(); i++)
+		{
+			if (!decoded[i]) continue;
+
+			const VkExtent3D imageExtent
+			{
+				.width = static_cast<uint32_t>(infos[i].width),
+				.height = static_cast<uint32_t>(infos[i].height),
+				.depth = 1
+			};
+
+			const VkBufferImageCopy copyRegion 
+			{
+				//RowLength and ImageHeight are 0
+				.bufferOffset = offsets[i],
+				.imageSubresource = 
+				{
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					//mipLevel is 0
+					//base array layer is 0
+					.layerCount = 1,
+				},
+				.imageExtent = imageExtent
+			};
+
+			uploads.push_back(ImageUpload{ .format = imageFormat, .extent = imageExtent, .copyRegions = { copyRegion }, .mipLevels = generateMips ? fullMipChainLength(imageExtent) : 1 });
+			uploadedIndices.push_back(i);
+		}
+
+		if (!uploads.empty())
+		{
+			const std::vector<vkut::LoadedImage> images = uploadImages(context, stagingBuffer, uploads);
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				results[uploadedIndices[i]] = images[i];
+			}
+		}
+		vkmem::destroyBuffer(context.allocator, stagingBuffer);
+	}
+}
+
+std::optional<vkut::LoadedImage> vkut::loadImageFromFile(ImageLoadContext context, const char *filePath)
+{
+	return loadImagesFromFiles(context, std::span(&filePath, 1)).front();
+}
+
+std::vector<std::optional<vkut::LoadedImage>> vkut::loadImagesFromFiles(ImageLoadContext context, std::span<const char *const> filePaths, ThreadPool *pool)
+{
+	//only the headers are read up front, which is enough to lay out the staging buffers
+	std::vector<ImageInfo> infos(filePaths.size());
+	auto readInfo = [&](size_t i)
+	{
+		int texChannels;
+		if (!stbi_info(filePaths[i], &infos[i].width, &infos[i].height, &texChannels))
+		{
+			infos[i] = {};
+		}
+	};
+
+	if (pool != nullptr)
+	{
+		pool->parallelFor(filePaths.size(), readInfo);
+	}
+	else
+	{
+		for (size_t i = 0; i < filePaths.size(); i++) readInfo(i);
+	}
+
+	std::vector<std::optional<LoadedImage>> results(filePaths.size());
+	size_t batchStart = 0;
+	VkDeviceSize batchBytes = 0;
+	for (size_t i = 0; i <= filePaths.size(); i++)
+	{
+		//an image bigger than the cap still gets a batch of its own
+		const bool batchFull = i == filePaths.size() || (batchBytes > 0 && batchBytes + infos[i].bytes() > maxBatchStagingBytes);
+		if (batchFull && i > batchStart)
+		{
+			const size_t count = i - batchStart;
+			loadImageBatch(context, filePaths.subspan(batchStart, count), std::span(infos).subspan(batchStart, count), std::span(results).subspan(batchStart, count), pool);
+			batchStart = i;
+			batchBytes = 0;
+		}
+		if (i < filePaths.size()) batchBytes += infos[i].bytes();
+	}
+	return results;
+}
 
+std::optional<vkut::LoadedImage> vkut::loadTextureFile(ImageLoadContext context, const char *filePath, ThreadPool *pool)
+{
+	const std::optional<TextureFile::Mapped> file = TextureFile::map(filePath);
+	if (!file.has_value())
+	{
+		return std::nullopt;
+	}
+
+	const TextureFile::Header &header = file->header();
+	AllocatedBuffer stagingBuffer = vkmem::createBuffer(header.payloadBytes(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, context.allocator, VMA_MEMORY_USAGE_CPU_ONLY);
+	if (!file->decompressPayload(static_cast<std::byte *>(vkmem::getMappedData(stagingBuffer)), pool))
+	{
+		Logger::logErrorFormatted("Could not decompress %s", filePath);
+		vkmem::destroyBuffer(context.allocator, stagingBuffer);
+		return std::nullopt;
+	}
+
+	std::vector<VkBufferImageCopy> copyRegions;
+	for (uint32_t level = 0; level < header.levels.size(); level++)
+	{
+		copyRegions.push_back(VkBufferImageCopy
+		{
+			//RowLength and ImageHeight are 0, the levels are tightly packed
+			.bufferOffset = header.levels[level].offset,
+			.imageSubresource =
+			{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = level,
+				.layerCount = 1,
+			},
+			.imageExtent = { .width = header.levels[level].width, .height = header.levels[level].height, .depth = 1 }
+		});
+	}
+
+	const ImageUpload upload
+	{
+		.format = header.vkFormat(),
+		.extent = { .width = header.width, .height = header.height, .depth = 1 },
+		.copyRegions = copyRegions,
+		.mipLevels = (uint32_t)copyRegions.size()
+	};
+	const LoadedImage newImage = uploadImages(context, stagingBuffer, { upload }).front();
 	vkmem::destroyBuffer(context.allocator, stagingBuffer);
 
-    return newImage;
+	return newImage;
 }
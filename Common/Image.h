@@ -3,17 +3,36 @@
 #include "vkutils.h"
 #include "VkTypes.h"
 #include <optional>
+#include <span>
+#include <vector>
 #include "MemoryUtils.h"
 
+class ThreadPool;
+
 namespace vkut
 {
 	struct ImageLoadContext 
 	{
+		VkPhysicalDevice physicalDevice; //to check whether mips can be blitted for the format
 		VkDevice device;
 		VmaAllocator allocator;
 		VkFence uploadFence;
 		VkCommandPool uploadCommandPool;
 		VkQueue queue;
 	};
-	std::optional<AllocatedImage> loadImageFromFile(ImageLoadContext context, const char *filePath);
+	struct LoadedImage
+	{
+		AllocatedImage image;
+		VkFormat format;
+		uint32_t mipLevels;
+	};
+
+	//decodes a png or the like at runtime into an uncompressed rgba8 image, whose mip chain is blitted down from it on the gpu
+	std::optional<LoadedImage> loadImageFromFile(ImageLoadContext context, const char *filePath);
+	//like loadImageFromFile for many images at once: they're decoded across the pool straight into shared staging buffers of up to 256MB,
+	//and each of those is uploaded with a single submission, so there's one fence wait per batch rather than per image
+	//the results line up with filePaths, with the images that couldn't be loaded left empty
+	std::vector<std::optional<LoadedImage>> loadImagesFromFiles(ImageLoadContext context, std::span<const char *const> filePaths, ThreadPool *pool = nullptr);
+	//a .tex from the asset compiler, its payload decompresses straight into staging and every mip level goes to the image in one copy
+	std::optional<LoadedImage> loadTextureFile(ImageLoadContext context, const char *filePath, ThreadPool *pool = nullptr);
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include "vulkan/vulkan.h"
+#include <assert.h>
+
+enum class IndexType : uint8_t
+{
+	uint16,
+	uint32,
+};
+
+[[nodiscard]]
+inline VkIndexType indexTypeToVkIndexType(const IndexType indexType)
+{
+	switch (indexType)
+	{
+	case IndexType::uint16:
+		return VK_INDEX_TYPE_UINT16;
+		break;
+	case IndexType::uint32:
+		return VK_INDEX_TYPE_UINT32;
+		break;
+	default:
+		assert(false);
+		return VK_INDEX_TYPE_UINT32;
+		break;
+	}
+}
+
+[[nodiscard]]
+inline size_t indexTypeToSize(const IndexType indexType)
+{
+	switch (indexType)
+	{
+	case IndexType::uint16:
+		return sizeof(uint16_t);
+		break;
+	case IndexType::uint32:
+		return sizeof(uint32_t);
+		break;
+	default:
+		assert(false);
+		return 0;
+		break;
+	}
+}
+
+//the narrowest type that can address every one of vertexAmount vertices
+[[nodiscard]]
+inline IndexType indexTypeFor(const size_t vertexAmount)
+{
+	return vertexAmount <= UINT16_MAX + 1 ? IndexType::uint16 : IndexType::uint32;
+}
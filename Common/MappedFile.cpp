@@ -0,0 +1,93 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::optional<MappedFile> MappedFile::open(const char *path)
+{
+	MappedFile file;
+
+#ifdef _WIN32
+	const HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) return std::nullopt;
+	file.fileHandle = fileHandle;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(fileHandle, &size)) return std::nullopt;
+	file.byteCount = (size_t)size.QuadPart;
+	if (file.byteCount == 0) return file; //empty files can't be mapped, but there's nothing to read either
+
+	file.mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (file.mappingHandle == nullptr) return std::nullopt;
+
+	file.bytes = static_cast<const std::byte *>(MapViewOfFile(file.mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (file.bytes == nullptr) return std::nullopt;
+#else
+	file.fileDescriptor = ::open(path, O_RDONLY);
+	if (file.fileDescriptor < 0) return std::nullopt;
+
+	struct stat status;
+	if (fstat(file.fileDescriptor, &status) != 0) return std::nullopt;
+	file.byteCount = (size_t)status.st_size;
+	if (file.byteCount == 0) return file;
+
+	void *mapping = mmap(nullptr, file.byteCount, PROT_READ, MAP_PRIVATE, file.fileDescriptor, 0);
+	if (mapping == MAP_FAILED) return std::nullopt;
+	file.bytes = static_cast<const std::byte *>(mapping);
+	madvise(mapping, file.byteCount, MADV_SEQUENTIAL);
+#endif
+
+	return file;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+	if (this == &other) return *this;
+	close();
+
+	bytes = std::exchange(other.bytes, nullptr);
+	byteCount = std::exchange(other.byteCount, 0);
+#ifdef _WIN32
+	fileHandle = std::exchange(other.fileHandle, nullptr);
+	mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#else
+	fileDescriptor = std::exchange(other.fileDescriptor, -1);
+#endif
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (bytes != nullptr) UnmapViewOfFile(bytes);
+	if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+	if (fileHandle != nullptr) CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (bytes != nullptr) munmap(const_cast<std::byte *>(bytes), byteCount);
+	if (fileDescriptor >= 0) ::close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	bytes = nullptr;
+	byteCount = 0;
+}
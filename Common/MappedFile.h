@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+
+//read only view of a whole file through the OS page cache, nothing is copied until the bytes are touched
+class MappedFile
+{
+public:
+
+	[[nodiscard]]
+	static std::optional<MappedFile> open(const char *path);
+
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	[[nodiscard]]
+	const std::byte *data() const { return bytes; }
+	[[nodiscard]]
+	size_t size() const { return byteCount; }
+
+private:
+
+	MappedFile() = default;
+	void close();
+
+	const std::byte *bytes = nullptr;
+	size_t byteCount = 0;
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+#else
+	int fileDescriptor = -1;
+#endif
+};
@@ -1,37 +1,91 @@
 #include "Mesh.h"
+#include <array>
+
+namespace
+{
+	//split off positions are binding 0 on their own, everything else shares the last binding
+	uint32_t bindingOf(const OFile &data, size_t attribute)
+	{
+		return data.vertexLayout() == OFile::VertexLayout::splitPositions && attribute > 0 ? 1U : 0U;
+	}
+
+	uint32_t bindingCount(const OFile &data)
+	{
+		return data.attributes().empty() ? 0U : bindingOf(data, data.attributes().size() - 1) + 1;
+	}
+}
 
 VertexInputDescription Mesh::getDescription() const
 {
 	const std::vector<AttributeType> &oFileAttributes = data.attributes();
 
 	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(oFileAttributes.size());
-	size_t offset = 0;
+	std::vector<size_t> strides(bindingCount(data), 0);
 	for (size_t i = 0; i < oFileAttributes.size(); i++)
 	{
+		const uint32_t binding = bindingOf(data, i);
 		attributeDescriptions[i] =
 		{
 			.location = (uint32_t)i,
-			.binding = 0U,
+			.binding = binding,
 			.format = attributeTypeToFormat(oFileAttributes[i]),
-			.offset = (uint32_t)offset
+			.offset = (uint32_t)strides[binding]
 		};
-		offset += attributeTypeToSize(oFileAttributes[i]);
+		strides[binding] += attributeTypeToSize(oFileAttributes[i]);
 	}
-	const size_t vertexSize = offset;
+
+	std::vector<VkVertexInputBindingDescription> bindings(strides.size());
+	for (size_t binding = 0; binding < strides.size(); binding++)
+	{
+		bindings[binding] =
+		{
+			.binding = (uint32_t)binding,
+			.stride = (uint32_t)strides[binding],
+			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+		};
+	}
+
+	return VertexInputDescription
+	{
+		.bindings = bindings,
+		.attributes = attributeDescriptions
+	};
+}
+
+VertexInputDescription Mesh::getPositionDescription() const
+{
+	const AttributeType positionType = data.attributes().front();
+	const size_t stride = data.vertexLayout() == OFile::VertexLayout::splitPositions ? attributeTypeToSize(positionType) : data.vertexSize();
 	return VertexInputDescription
 	{
 		.bindings
 		{
 			{
 				.binding = 0U,
-				.stride = (uint32_t)vertexSize,
+				.stride = (uint32_t)stride,
 				.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
 			}
 		},
-		.attributes = attributeDescriptions
+		.attributes
+		{
+			{
+				.location = 0U,
+				.binding = 0U,
+				.format = attributeTypeToFormat(positionType),
+				.offset = 0U
+			}
+		}
 	};
 }
 
+void Mesh::bindVertexBuffers(VkCommandBuffer cmd) const
+{
+	//both bindings read the one buffer, the second from where the positions end
+	const std::array<VkBuffer, 2> buffers = { vertexBuffer.buffer, vertexBuffer.buffer };
+	const std::array<VkDeviceSize, 2> offsets = { 0, data.header().positionStreamBytes() };
+	vkCmdBindVertexBuffers(cmd, 0, bindingCount(data), buffers.data(), offsets.data());
+}
+
 std::optional<Mesh> Mesh::load(const char *path)
 {
 	auto loadResult = OFile::load(path);
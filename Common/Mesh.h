@@ -14,7 +14,12 @@ struct VertexInputDescription {
 
 struct Mesh
 {
+	//every attribute in order from location 0, in one binding or two if the positions are split off
 	VertexInputDescription getDescription() const;
+	//only the positions at location 0, for depth only and shadow passes, which then fetch nothing else if the positions are split off
+	VertexInputDescription getPositionDescription() const;
+	//binds the vertex buffer to every binding the descriptions above use
+	void bindVertexBuffers(VkCommandBuffer cmd) const;
 	static std::optional<Mesh> load(const char *path);
 	
 	OFile data;
@@ -3,7 +3,8 @@
 #include "Files.h"
 #include "Logger/Logger.h"
 #include "Serializer.h"
-#include <lz4/lz4.h>
+#include <algorithm>
+#include <chrono>
 
 #define WRITER_CHECK(expr) if(!(expr)) return false;
 
@@ -18,80 +19,291 @@ size_t sizeForAttributes(const std::vector<AttributeType> &attributes)
 	return size;
 }
 
-OFile::FileData parseFileData(std::byte* bytes, size_t size)
+std::optional<OFile::Mapped> OFile::map(const char *path)
 {
-	OFile::FileData fileData;
-	StreamIn stream(bytes, size);
-	fileData.attributes.resize(stream.getNext<size_t>());
-	stream.getNext(fileData.attributes.data(), fileData.attributes.size());
+	std::optional<MappedFile> file = MappedFile::open(path);
+	if (!file.has_value())
+	{
+		return std::nullopt;
+	}
+
+	constexpr size_t smallestHeader = sizeof(magic) + sizeof(formatVersion) + sizeof(size_t);
+	if (file->size() < smallestHeader)
+	{
+		Logger::logErrorFormatted("%s is too small to be a .o file", path);
+		return std::nullopt;
+	}
+
+	//the mapping is read only, StreamIn just doesn't know about const
+	StreamIn stream(const_cast<std::byte *>(file->data()), file->size());
+	const uint32_t fileMagic = stream.getNext<uint32_t>();
+	const uint32_t version = stream.getNext<uint32_t>();
+	if (fileMagic != magic || version != formatVersion)
+	{
+		Logger::logErrorFormatted("%s is not a version %u .o file, it needs recompiling", path, formatVersion);
+		return std::nullopt;
+	}
+
+	Header header;
+	const size_t attributeCount = stream.getNext<size_t>();
+	constexpr size_t fixedHeaderSize = sizeof(VertexLayout) + sizeof(vec3) * 2 + sizeof(Bounds) + sizeof(size_t) * 3 + sizeof(IndexType);
+	if (file->size() - smallestHeader < fixedHeaderSize || attributeCount > (file->size() - smallestHeader - fixedHeaderSize) / sizeof(AttributeType))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+
+	header.attributes.resize(attributeCount);
+	stream.getNext(header.attributes.data(), header.attributes.size());
+	if (std::any_of(header.attributes.begin(), header.attributes.end(), [](AttributeType attribute) { return attribute > AttributeType::snorm8x4; }))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+	header.vertexLayout = stream.getNext<VertexLayout>();
+	if (header.vertexLayout > VertexLayout::splitPositions || (header.vertexLayout == VertexLayout::splitPositions && header.attributes.empty()))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+	header.positionOffset = stream.getNext<vec3>();
+	header.positionScale = stream.getNext<vec3>();
+	header.bounds = stream.getNext<Bounds>();
+	header.vertexAmount = stream.getNext<size_t>();
+	header.indexType = stream.getNext<IndexType>();
+	header.indexAmount = stream.getNext<size_t>();
+
+	//half of size_t each, so payloadBytes can't overflow either
+	const size_t vertexSize = sizeForAttributes(header.attributes);
+	if (header.indexType > IndexType::uint32
+		|| (vertexSize != 0 && header.vertexAmount > SIZE_MAX / 2 / vertexSize)
+		|| header.indexAmount > SIZE_MAX / 2 / indexTypeToSize(header.indexType))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+
+	const size_t submeshCount = stream.getNext<size_t>();
+	if (submeshCount > (file->size() - stream.bytesRead()) / sizeof(Submesh))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+	header.submeshes.resize(submeshCount);
+	stream.getNext(header.submeshes.data(), header.submeshes.size());
+	for (const Submesh &submesh : header.submeshes)
+	{
+		if ((uint64_t)submesh.firstIndex + submesh.indexCount > header.indexAmount)
+		{
+			Logger::logErrorFormatted("%s has a submesh outside its indices", path);
+			return std::nullopt;
+		}
+	}
+
+	const size_t meshletCount = file->size() - stream.bytesRead() >= sizeof(size_t) ? stream.getNext<size_t>() : SIZE_MAX;
+	if (meshletCount > (file->size() - stream.bytesRead()) / sizeof(Meshlet))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+	header.meshlets.resize(meshletCount);
+	stream.getNext(header.meshlets.data(), header.meshlets.size());
+
+	const size_t lodCount = file->size() - stream.bytesRead() >= sizeof(size_t) ? stream.getNext<size_t>() : SIZE_MAX;
+	if (lodCount > (file->size() - stream.bytesRead()) / sizeof(Lod))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+	header.lods.resize(lodCount);
+	stream.getNext(header.lods.data(), header.lods.size());
+
+	//everything the engine indexes with these, so a corrupt file can't send it past the end of the lods or the index buffer
+	const auto outsideIndices = [&](uint64_t first, uint64_t count) { return first + count > header.indexAmount; };
+	const bool corruptRanges = std::any_of(header.submeshes.begin(), header.submeshes.end(), [&](const Submesh &submesh)
+		{
+			return (uint64_t)submesh.firstLod + submesh.lodCount > header.lods.size() || (uint64_t)submesh.firstMeshlet + submesh.meshletCount > header.meshlets.size();
+		})
+		|| std::any_of(header.lods.begin(), header.lods.end(), [&](const Lod &lod) { return outsideIndices(lod.firstIndex, lod.indexCount); })
+		|| std::any_of(header.meshlets.begin(), header.meshlets.end(), [&](const Meshlet &meshlet) { return outsideIndices(meshlet.firstIndex, (uint64_t)meshlet.triangleCount * 3); });
+	if (corruptRanges)
+	{
+		Logger::logErrorFormatted("%s has a lod or meshlet outside its indices", path);
+		return std::nullopt;
+	}
 
-	uint16_t objectNumber = stream.getNext<uint16_t>();
-	(void *)objectNumber;
+	//the chunk table: the compressed size of every chunk, the chunks follow it back to back
+	const size_t chunkCount = payload::chunkCountFor(header.payloadBytes());
+	if (file->size() - stream.bytesRead() < sizeof(size_t) || stream.getNext<size_t>() != chunkCount
+		|| chunkCount * sizeof(uint32_t) > file->size() - stream.bytesRead())
+	{
+		Logger::logErrorFormatted("%s has a corrupt chunk table", path);
+		return std::nullopt;
+	}
 
-	fileData.vertexAmount = stream.getNext<size_t>();
-	fileData.vertices.resize(sizeForAttributes(fileData.attributes) * fileData.vertexAmount);
-	stream.getNext(fileData.vertices.data(), fileData.vertices.size());
+	std::vector<uint32_t> compressedSizes(chunkCount);
+	stream.getNext(compressedSizes.data(), compressedSizes.size());
 
-	fileData.indices.resize(stream.getNext<size_t>());
-	stream.getNext(fileData.indices.data(), fileData.indices.size());
+	std::vector<size_t> chunkOffsets(chunkCount + 1, stream.bytesRead());
+	for (size_t i = 0; i < chunkCount; i++) chunkOffsets[i + 1] = chunkOffsets[i] + compressedSizes[i];
+	if (chunkOffsets.back() > file->size())
+	{
+		Logger::logErrorFormatted("%s is truncated", path);
+		return std::nullopt;
+	}
 
-	return fileData;
+	return Mapped(std::move(file.value()), std::move(header), std::move(chunkOffsets));
+}
+
+bool OFile::Mapped::decompressChunk(size_t chunk, std::byte *destination) const
+{
+	return payload::decompressChunk(file.data(), chunkOffsets, fileHeader.payloadBytes(), chunk, destination);
 }
 
-std::optional<OFile> OFile::load(const char* path)
+bool OFile::Mapped::decompressPayload(std::byte *destination, ThreadPool *pool) const
 {
-	OFile file;
-	OFile::FileData &fileData = file.fileData;
+	return payload::decompress(file.data(), chunkOffsets, fileHeader.payloadBytes(), destination, pool);
+}
+
+bool OFile::Mapped::decompressRange(std::byte *destination, size_t offset, size_t size) const
+{
+	if (size == 0) return true;
+	if (offset > fileHeader.payloadBytes() || size > fileHeader.payloadBytes() - offset) return false;
+
+	std::vector<std::byte> scratch;
+	const size_t end = offset + size;
+	for (size_t chunk = offset / payloadChunkSize; chunk * payloadChunkSize < end; chunk++)
+	{
+		const size_t chunkBegin = chunk * payloadChunkSize;
+		const size_t chunkEnd = std::min<size_t>(chunkBegin + payloadChunkSize, fileHeader.payloadBytes());
+
+		//chunks the range fully covers go straight to destination, the ones at its edges through scratch
+		if (chunkBegin >= offset && chunkEnd <= end)
+		{
+			if (!decompressChunk(chunk, destination + (chunkBegin - offset))) return false;
+			continue;
+		}
+
+		scratch.resize(chunkEnd - chunkBegin);
+		if (!decompressChunk(chunk, scratch.data())) return false;
+
+		const size_t copyBegin = std::max(chunkBegin, offset);
+		const size_t copyEnd = std::min(chunkEnd, end);
+		memcpy(destination + (copyBegin - offset), scratch.data() + (copyBegin - chunkBegin), copyEnd - copyBegin);
+	}
+
+	return true;
+}
 
-	FileReader reader(path);
-	if(reader.failed())
+std::optional<OFile> OFile::load(const char* path, ThreadPool *pool)
+{
+	const std::optional<Mapped> mapped = map(path);
+	if (!mapped.has_value())
 	{
 		return std::nullopt;
 	}
 
-	std::vector<std::byte> compressedData = reader.readInto<std::vector<std::byte>>();
-	StreamIn stream(compressedData.data(), compressedData.size());
-	const size_t uncompressedSize = stream.getNext<size_t>();
-	
-	std::vector<uint8_t> data = std::vector<uint8_t>(uncompressedSize);
+	std::vector<std::byte> payload(mapped->header().payloadBytes());
+	if (!mapped->decompressPayload(payload.data(), pool))
+	{
+		Logger::logErrorFormatted("Could not decompress %s", path);
+		return std::nullopt;
+	}
 
-	LZ4_decompress_safe((const char*)(compressedData.data()+sizeof(uncompressedSize)), (char*)data.data(), (int)compressedData.size()-sizeof(uncompressedSize), (int)data.size());
-	file.fileData = parseFileData((std::byte*)data.data(), data.size());
-	
+	OFile file(mapped->header());
+	const auto indicesBegin = payload.begin() + file.fileData.header.vertexBytes();
+	file.fileData.vertices.assign(payload.begin(), indicesBegin);
+	file.fileData.indices.assign(indicesBegin, payload.end());
 	return file;
 }
 
-bool OFile::save(const char* path, const OFile::FileData &data)
+bool OFile::save(const char* path, const OFile::FileData &data, ThreadPool *pool, int compressionLevel, CompressionStatistics *statistics)
 {
-	StretchyStreamOut streamOut = StretchyStreamOut();
+	const Header &header = data.header;
+	StretchyStreamOut headerOut = StretchyStreamOut();
+	headerOut.setNext(magic);
+	headerOut.setNext(formatVersion);
+	headerOut.setNext(header.attributes.size());
+	headerOut.setNext(header.attributes.data(), header.attributes.size());
+	headerOut.setNext(header.vertexLayout);
+	headerOut.setNext(header.positionOffset);
+	headerOut.setNext(header.positionScale);
+	headerOut.setNext(header.bounds);
+	headerOut.setNext(header.vertexAmount);
+	headerOut.setNext(header.indexType);
+	headerOut.setNext(header.indexAmount);
+	headerOut.setNext(header.submeshes.size());
+	if (!header.submeshes.empty()) headerOut.setNext(header.submeshes.data(), header.submeshes.size());
+	headerOut.setNext(header.meshlets.size());
+	if (!header.meshlets.empty()) headerOut.setNext(header.meshlets.data(), header.meshlets.size());
+	headerOut.setNext(header.lods.size());
+	if (!header.lods.empty()) headerOut.setNext(header.lods.data(), header.lods.size());
 
-	streamOut.setNext(data.attributes.size());
-	streamOut.setNext(data.attributes.data(), data.attributes.size());
+	std::vector<std::byte> payload;
+	payload.reserve(data.vertices.size() + data.indices.size());
+	payload.insert(payload.end(), data.vertices.begin(), data.vertices.end());
+	payload.insert(payload.end(), data.indices.begin(), data.indices.end());
 
-	constexpr uint16_t objectNumber = 1; //todo: support multiple objects in the same file
-	streamOut.setNext(objectNumber);
+	const auto compressionStart = std::chrono::steady_clock::now();
+	const std::optional<payload::Compressed> compressed = payload::compress(payload, pool, compressionLevel);
+	WRITER_CHECK(compressed.has_value());
 
-	streamOut.setNext(data.vertexAmount);
-	streamOut.setNext(data.vertices.data(), data.vertices.size());
+	if (statistics != nullptr)
+	{
+		*statistics = CompressionStatistics
+		{
+			.payloadBytes = payload.size(),
+			.compressedBytes = compressed->chunks.size(),
+			.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - compressionStart).count()
+		};
+	}
 
-	streamOut.setNext(data.indices.size());
-	streamOut.setNext(data.indices.data(), data.indices.size());
+	headerOut.setNext(compressed->chunkSizes.size());
+	if (!compressed->chunkSizes.empty()) headerOut.setNext(compressed->chunkSizes.data(), compressed->chunkSizes.size());
 
-	const int compressStaging = LZ4_compressBound((int)streamOut.bytesWritten());
-	std::vector<std::byte> compressed(compressStaging);
-	const int compressedSize = LZ4_compress_default((const char *)streamOut.getData(), (char*)compressed.data(), (int)streamOut.bytesWritten(), compressStaging);
-	compressed.resize(compressedSize);
+	//the chunks are packed right behind the header and chunk table so the file goes out in one write
+	const size_t headerSize = headerOut.bytesWritten();
+	std::vector<std::byte> fileBytes(headerSize);
+	fileBytes.reserve(headerSize + compressed->chunks.size());
+	memcpy(fileBytes.data(), headerOut.getData(), headerSize);
+	fileBytes.insert(fileBytes.end(), compressed->chunks.begin(), compressed->chunks.end());
 
 	FileWriter writer(path);
-	WRITER_CHECK(writer.write(streamOut.bytesWritten()));
-	WRITER_CHECK(writer.writeVector(compressed));
+	WRITER_CHECK(writer.writeVector(fileBytes));
 
 	return true;
 }
 
 #undef WRITER_CHECK
 
+void OFile::setIndices(FileData &data, const std::vector<uint32_t> &indices)
+{
+	data.header.indexType = indexTypeFor(data.header.vertexAmount);
+	data.header.indexAmount = indices.size();
+	data.indices.resize(data.header.indexBytes());
+
+	if (data.header.indexType == IndexType::uint32)
+	{
+		memcpy(data.indices.data(), indices.data(), data.indices.size());
+		return;
+	}
+
+	StreamOut stream(data.indices.data(), data.indices.size());
+	for (const uint32_t index : indices) stream.setNext((uint16_t)index);
+}
+
 size_t OFile::vertexSize() const
 {
 	return sizeForAttributes(attributes());
 }
+
+size_t OFile::Header::vertexBytes() const
+{
+	return sizeForAttributes(attributes) * vertexAmount;
+}
+
+size_t OFile::Header::positionStreamBytes() const
+{
+	if (vertexLayout != VertexLayout::splitPositions) return 0;
+	return attributeTypeToSize(attributes.front()) * vertexAmount;
+}
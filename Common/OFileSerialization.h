@@ -1,7 +1,14 @@
 #pragma once
 #include <vector>
 #include "AttributeType.h"
+#include "IndexType.h"
+#include "MappedFile.h"
+#include "PayloadCompression.h"
+#include "mat.h"
 #include <optional>
+#include <span>
+
+class ThreadPool;
 
 class OFile
 {
@@ -9,33 +16,207 @@ public:
 
 	OFile(){}
 
-	struct FileData
+	static constexpr uint32_t magic = 0x4C49464F; //"OFIL"
+	static constexpr uint32_t formatVersion = 9;
+
+	//the payload is compressed in independent chunks of this many bytes, see PayloadCompression.h
+	static constexpr uint32_t payloadChunkSize = payload::chunkSize;
+
+	//how the attributes are arranged in the vertex bytes
+	enum class VertexLayout : uint8_t
+	{
+		interleaved,	//all of a vertex's attributes next to each other, in one binding
+		splitPositions,	//every position tightly packed in binding 0, then the other attributes interleaved in binding 1, so depth only passes fetch nothing but positions
+	};
+
+	//model space bounds, computed by the compiler so nothing at runtime needs to look at the vertices to cull or build spatial structures
+	struct Bounds
+	{
+		vec3 minimum = {};
+		vec3 maximum = {};
+		vec3 center = {}; //the bounding sphere, usually tighter than the one around the box
+		float radius = {};
+	};
+
+	//a range of the index buffer drawn with one material, e.g. one part of a level
+	struct Submesh
+	{
+		uint32_t firstIndex = {};
+		uint32_t indexCount = {};
+		uint32_t materialSlot = {}; //index of the material in the source's material library, 0 when it had none
+		Bounds bounds = {}; //of the vertices the range uses
+		uint32_t firstMeshlet = {};
+		uint32_t meshletCount = {};
+		uint32_t firstLod = {}; //the submesh's own range is the full detail level, these are the simplified ones from finest to coarsest
+		uint32_t lodCount = {};
+	};
+
+	//a simplified version of a submesh, its indices come after every submesh's full detail ones and use the same vertices
+	struct Lod
+	{
+		uint32_t firstIndex = {};
+		uint32_t indexCount = {};
+		float error = {}; //how far the surface may be from the full detail one, in model units, project it to pick a level
+	};
+
+	//a run of triangles in the index buffer touching only a few dozen vertices, small enough to be culled on its own
+	struct Meshlet
+	{
+		uint32_t firstIndex = {};
+		uint32_t triangleCount = {};
+		vec3 center = {}; //model space bounding sphere
+		float radius = {};
+		vec3 coneAxis = {}; //every triangle's normal is within the cone around coneAxis, a coneCutoff of 1 means the cone is too wide to ever cull
+		float coneCutoff = {};
+
+		//true if every triangle faces away from a viewer at eye, in the same space as the meshlet
+		[[nodiscard]]
+		bool facesAway(const vec3 &eye) const
+		{
+			const vec3 toCenter = center - eye;
+			return vec3::dot(toCenter, coneAxis) >= coneCutoff * toCenter.length() + radius;
+		}
+	};
+
+	//everything but the vertex and index bytes, stored uncompressed at the front of the file so the destination of the payload can be set up before decompressing it
+	struct Header
 	{
 		std::vector<AttributeType> attributes = {};
+		VertexLayout vertexLayout = VertexLayout::interleaved;
 		size_t vertexAmount = {};
+		IndexType indexType = IndexType::uint32;
+		size_t indexAmount = {};
+
+		//unorm16x4 positions are dequantised as positionOffset + positionScale * stored, other position types ignore these
+		vec3 positionOffset = { .0f, .0f, .0f };
+		vec3 positionScale = { 1.0f, 1.0f, 1.0f };
+
+		Bounds bounds = {}; //of every vertex
+
+		//always at least one, covering every index if the source had no structure
+		std::vector<Submesh> submeshes = {};
+		std::vector<Meshlet> meshlets = {};
+		std::vector<Lod> lods = {};
+
+		[[nodiscard]]
+		size_t vertexBytes() const;
+		//the positions at the front of the vertex bytes, 0 when they're interleaved with the other attributes
+		[[nodiscard]]
+		size_t positionStreamBytes() const;
+		[[nodiscard]]
+		size_t indexBytes() const { return indexAmount * indexTypeToSize(indexType); }
+		//the payload is the vertices followed by the indices
+		[[nodiscard]]
+		size_t payloadBytes() const { return vertexBytes() + indexBytes(); }
+	};
+
+	//what save did with the payload, for weighing file size against compile time
+	struct CompressionStatistics
+	{
+		size_t payloadBytes = {};
+		size_t compressedBytes = {};
+		float milliseconds = {};
+	};
+
+	struct FileData
+	{
+		Header header = {};
 		std::vector<std::byte> vertices = {};
-		std::vector<uint32_t> indices = {};
+		std::vector<std::byte> indices = {};
 	};
 
-	static std::optional<OFile> load(const char* path);
-	static bool save(const char* path, const FileData &data);
+	//a mapped .o whose payload hasn't been touched yet, so it can be decompressed straight into its final home, e.g. a mapped staging buffer
+	class Mapped
+	{
+	public:
+
+		[[nodiscard]]
+		const Header &header() const { return fileHeader; }
+
+		//writes header().payloadBytes() bytes to destination, spreading the chunks across pool if there is one
+		[[nodiscard]]
+		bool decompressPayload(std::byte *destination, ThreadPool *pool = nullptr) const;
+
+		//writes the payload bytes [offset, offset + size) to destination, only the chunks overlapping them are decompressed
+		[[nodiscard]]
+		bool decompressRange(std::byte *destination, size_t offset, size_t size) const;
+
+		[[nodiscard]]
+		size_t chunkCount() const { return chunkOffsets.size() - 1; }
+
+		//every compressed chunk back to back, which runs to the end of the file
+		[[nodiscard]]
+		std::span<const std::byte> compressedPayload() const { return { file.data() + chunkOffsets.front(), chunkOffsets.back() - chunkOffsets.front() }; }
+
+	private:
+
+		friend class OFile;
+		Mapped(MappedFile &&givenFile, Header &&givenHeader, std::vector<size_t> &&givenChunkOffsets)
+			: file(std::move(givenFile)), fileHeader(std::move(givenHeader)), chunkOffsets(std::move(givenChunkOffsets)) {}
+
+		//decompresses the whole of chunk to destination, which needs room for payloadChunkSize bytes or whatever is left of the payload
+		[[nodiscard]]
+		bool decompressChunk(size_t chunk, std::byte *destination) const;
+
+		MappedFile file;
+		Header fileHeader;
+		std::vector<size_t> chunkOffsets; //where each chunk starts in the file, plus where the last one ends
+	};
+
+	//only the header is kept, for meshes whose vertices and indices went straight to the GPU
+	explicit OFile(Header header) : fileData{ .header = std::move(header) } {}
+
+	[[nodiscard]]
+	static std::optional<Mapped> map(const char *path);
+	static std::optional<OFile> load(const char* path, ThreadPool *pool = nullptr);
+	//compressionLevel is passed on to payload::compress
+	static bool save(const char* path, const FileData &data, ThreadPool *pool = nullptr, int compressionLevel = 0, CompressionStatistics *statistics = nullptr);
+
+	//packs indices into the narrowest IndexType that can address vertexAmount vertices
+	static void setIndices(FileData &data, const std::vector<uint32_t> &indices);
+
+	[[nodiscard]]
+	const Header &header() const { return fileData.header; }
+
+	[[nodiscard]]
+	const std::vector<AttributeType> &attributes() const { return fileData.header.attributes; }
 
 	[[nodiscard]]
-	const std::vector<AttributeType> &attributes() const { return fileData.attributes; }
+	VertexLayout vertexLayout() const { return fileData.header.vertexLayout; }
 
 	[[nodiscard]]
-	size_t vertexAmount() const { return fileData.vertexAmount; }
+	size_t vertexAmount() const { return fileData.header.vertexAmount; }
 	[[nodiscard]]
 	size_t vertexSize() const;
 
+	//vertices and indices are empty if the file was only mapped
 	[[nodiscard]]
 	const std::vector<std::byte> &vertices() const { return fileData.vertices; };
 	[[nodiscard]]
-	const std::vector<uint32_t> &indices() const { return fileData.indices; };
+	const std::vector<std::byte> &indices() const { return fileData.indices; };
+	[[nodiscard]]
+	IndexType indexType() const { return fileData.header.indexType; }
+	[[nodiscard]]
+	size_t indexAmount() const { return fileData.header.indexAmount; }
+	[[nodiscard]]
+	const std::vector<Submesh> &submeshes() const { return fileData.header.submeshes; }
+	[[nodiscard]]
+	const std::vector<Meshlet> &meshlets() const { return fileData.header.meshlets; }
+	[[nodiscard]]
+	const std::vector<Lod> &lods() const { return fileData.header.lods; }
+
+	[[nodiscard]]
+	const Bounds &bounds() const { return fileData.header.bounds; }
+
+	[[nodiscard]]
+	bool hasQuantisedPositions() const { return !attributes().empty() && attributes()[0] == AttributeType::unorm16x4; }
+	//maps quantised positions back to model space, meant to be folded into the model matrix
+	[[nodiscard]]
+	mat4x4 positionDequantisation() const { return mat4x4::translate(fileData.header.positionOffset) * mat4x4::scale(fileData.header.positionScale); }
 	
 
 private:
 
 	FileData fileData = {};
 
-};
\ No newline at end of file
+};
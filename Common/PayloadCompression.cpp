@@ -0,0 +1,69 @@
+#include "PayloadCompression.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <lz4/lz4.h>
+#include <lz4/lz4hc.h>
+
+std::optional<payload::Compressed> payload::compress(std::span<const std::byte> bytes, ThreadPool *pool, int compressionLevel)
+{
+	//every chunk gets a slot big enough for its worst case, so they can all be compressed at once
+	const size_t chunkCount = chunkCountFor(bytes.size());
+	const size_t chunkBound = (size_t)LZ4_compressBound((int)chunkSize);
+	std::vector<std::byte> compressStaging(chunkCount * chunkBound);
+	std::vector<uint32_t> compressedSizes(chunkCount);
+
+	auto compressChunk = [&](size_t chunk)
+	{
+		const size_t chunkBegin = chunk * chunkSize;
+		const size_t currentChunkSize = std::min<size_t>(chunkSize, bytes.size() - chunkBegin);
+		const char *source = (const char *)bytes.data() + chunkBegin;
+		char *destination = (char *)compressStaging.data() + chunk * chunkBound;
+		const int compressedSize = compressionLevel > 0
+			? LZ4_compress_HC(source, destination, (int)currentChunkSize, (int)chunkBound, std::min(compressionLevel, LZ4HC_CLEVEL_MAX))
+			: LZ4_compress_default(source, destination, (int)currentChunkSize, (int)chunkBound);
+		compressedSizes[chunk] = compressedSize > 0 ? (uint32_t)compressedSize : 0;
+	};
+
+	if (pool != nullptr) pool->parallelFor(chunkCount, compressChunk);
+	else for (size_t chunk = 0; chunk < chunkCount; chunk++) compressChunk(chunk);
+
+	if (std::find(compressedSizes.begin(), compressedSizes.end(), 0u) != compressedSizes.end()) return std::nullopt;
+
+	Compressed compressed{ .chunkSizes = std::move(compressedSizes) };
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		const std::byte *chunkBytes = compressStaging.data() + chunk * chunkBound;
+		compressed.chunks.insert(compressed.chunks.end(), chunkBytes, chunkBytes + compressed.chunkSizes[chunk]);
+	}
+	return compressed;
+}
+
+bool payload::decompressChunk(const std::byte *file, const std::vector<size_t> &chunkOffsets, size_t payloadBytes, size_t chunk, std::byte *destination)
+{
+	const size_t decompressedSize = std::min<size_t>(chunkSize, payloadBytes - chunk * chunkSize);
+	const size_t compressedSize = chunkOffsets[chunk + 1] - chunkOffsets[chunk];
+	const int writtenSize = LZ4_decompress_safe((const char *)file + chunkOffsets[chunk], (char *)destination, (int)compressedSize, (int)decompressedSize);
+
+	return writtenSize >= 0 && (size_t)writtenSize == decompressedSize;
+}
+
+bool payload::decompress(const std::byte *file, const std::vector<size_t> &chunkOffsets, size_t payloadBytes, std::byte *destination, ThreadPool *pool)
+{
+	const size_t chunkCount = chunkOffsets.size() - 1;
+	if (pool == nullptr || chunkCount < 2)
+	{
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			if (!decompressChunk(file, chunkOffsets, payloadBytes, chunk, destination + chunk * chunkSize)) return false;
+		}
+		return true;
+	}
+
+	std::atomic<bool> succeeded = true;
+	pool->parallelFor(chunkCount, [&](size_t chunk)
+	{
+		if (!decompressChunk(file, chunkOffsets, payloadBytes, chunk, destination + chunk * chunkSize)) succeeded = false;
+	});
+	return succeeded;
+}
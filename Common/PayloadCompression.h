@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+//the payloads of .o and .tex files are compressed in independent LZ4 chunks, so they can be decompressed in parallel or on their own
+namespace payload
+{
+	//LZ4 only looks 64 KB back anyway, so chunks this big cost next to nothing in ratio
+	constexpr uint32_t chunkSize = 256 * 1024;
+
+	[[nodiscard]]
+	constexpr size_t chunkCountFor(size_t payloadBytes) { return (payloadBytes + chunkSize - 1) / chunkSize; }
+
+	struct Compressed
+	{
+		std::vector<uint32_t> chunkSizes = {};
+		std::vector<std::byte> chunks = {}; //back to back, in payload order
+	};
+
+	//compressionLevel 0 uses the fast LZ4 compressor, anything above uses LZ4HC at that level, up to LZ4HC_CLEVEL_MAX
+	//both decompress with the same code at the same speed, higher levels only trade compile time for smaller files
+	[[nodiscard]]
+	std::optional<Compressed> compress(std::span<const std::byte> bytes, ThreadPool *pool = nullptr, int compressionLevel = 0);
+
+	//decompresses the whole of chunk to destination, which needs room for chunkSize bytes or whatever is left of the payload
+	//chunkOffsets holds where each chunk starts in file, plus where the last one ends
+	[[nodiscard]]
+	bool decompressChunk(const std::byte *file, const std::vector<size_t> &chunkOffsets, size_t payloadBytes, size_t chunk, std::byte *destination);
+
+	//writes all payloadBytes to destination, spreading the chunks across pool if there is one
+	[[nodiscard]]
+	bool decompress(const std::byte *file, const std::vector<size_t> &chunkOffsets, size_t payloadBytes, std::byte *destination, ThreadPool *pool = nullptr);
+}
@@ -0,0 +1,66 @@
+#include "SamplerCache.h"
+#include "vkutils.h"
+#include <tuple>
+
+namespace vkut
+{
+	namespace
+	{
+		//every field that changes how the sampler filters, in one tuple so == and hash can't drift apart
+		auto samplerFields(const VkSamplerCreateInfo &info)
+		{
+			return std::make_tuple(info.flags, info.magFilter, info.minFilter, info.mipmapMode,
+				info.addressModeU, info.addressModeV, info.addressModeW, info.mipLodBias,
+				info.anisotropyEnable, info.maxAnisotropy, info.compareEnable, info.compareOp,
+				info.minLod, info.maxLod, info.borderColor, info.unnormalizedCoordinates);
+		}
+	}
+
+	SamplerCache::SamplerCache(VkDevice givenDevice) : device(givenDevice)
+	{
+	}
+
+	SamplerCache::~SamplerCache()
+	{
+		for (auto pair : samplerCache) {
+			vkDestroySampler(device, pair.second, nullptr);
+		}
+		samplerCache.clear();
+	}
+
+	VkSampler SamplerCache::getSampler(const VkSamplerCreateInfo &info)
+	{
+		const SamplerInfo samplerInfo{ .info = info };
+
+		auto it = samplerCache.find(samplerInfo);
+		if (it != samplerCache.end())
+		{
+			return (*it).second;
+		}
+		else
+		{
+			VkSampler sampler;
+			VK_CHECK(vkCreateSampler(device, &info, nullptr, &sampler));
+
+			//add to cache
+			samplerCache[samplerInfo] = sampler;
+			return sampler;
+		}
+	}
+
+	bool SamplerCache::SamplerInfo::operator==(const SamplerInfo &other) const
+	{
+		return samplerFields(info) == samplerFields(other.info);
+	}
+
+	size_t SamplerCache::SamplerInfo::hash() const
+	{
+		size_t result = 0;
+		std::apply([&](const auto &...fields)
+		{
+			//boost's hash_combine
+			((result ^= std::hash<std::decay_t<decltype(fields)>>()(fields) + 0x9e3779b9 + (result << 6) + (result >> 2)), ...);
+		}, samplerFields(info));
+		return result;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+
+namespace vkut
+{
+	//hands out one sampler per distinct create info, so textures that filter the same way share it
+	class SamplerCache
+	{
+	public:
+		SamplerCache(VkDevice device);
+		~SamplerCache();
+
+		//pNext is not part of the key, so it has to be null
+		[[nodiscard]] VkSampler getSampler(const VkSamplerCreateInfo &info);
+
+	private:
+
+		struct SamplerInfo
+		{
+			VkSamplerCreateInfo info;
+			bool operator ==(const SamplerInfo &other) const;
+			size_t hash() const;
+		};
+
+		struct SamplerHash
+		{
+			std::size_t operator()(const SamplerInfo &info) const
+			{
+				return info.hash();
+			}
+		};
+
+		std::unordered_map<SamplerInfo, VkSampler, SamplerHash> samplerCache;
+		VkDevice device;
+	};
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include "vulkan/vulkan.h"
+#include <assert.h>
+
+enum class TextureFormat : uint8_t
+{
+	rgba8,	//uncompressed, for when blocks would show
+	bc1,	//rgb at 4 bits per pixel, alpha is dropped
+	bc3,	//rgba at 8 bits per pixel, the alpha gets a block of its own
+	bc5,	//two independent channels at 8 bits per pixel, for normal maps whose z is rebuilt in the shader
+	bc7,	//rgba at 8 bits per pixel, much closer to the source than bc1 and bc3
+};
+
+[[nodiscard]]
+inline VkFormat textureFormatToVkFormat(const TextureFormat textureFormat, const bool srgb)
+{
+	switch (textureFormat)
+	{
+	case TextureFormat::rgba8:
+		return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		break;
+	case TextureFormat::bc1:
+		return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		break;
+	case TextureFormat::bc3:
+		return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+		break;
+	case TextureFormat::bc5:
+		//two channels of data, never colors
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+		break;
+	case TextureFormat::bc7:
+		return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+		break;
+	default:
+		assert(false);
+		return VK_FORMAT_UNDEFINED;
+		break;
+	}
+}
+
+//bytes per 4x4 block for the block compressed formats, per pixel for the rest
+[[nodiscard]]
+inline size_t textureFormatToBlockSize(const TextureFormat textureFormat)
+{
+	switch (textureFormat)
+	{
+	case TextureFormat::rgba8:
+		return sizeof(uint8_t) * 4;
+		break;
+	case TextureFormat::bc1:
+		return 8;
+		break;
+	case TextureFormat::bc3:
+	case TextureFormat::bc5:
+	case TextureFormat::bc7:
+		return 16;
+		break;
+	default:
+		assert(false);
+		return 0;
+		break;
+	}
+}
+
+[[nodiscard]]
+inline bool isBlockCompressed(const TextureFormat textureFormat)
+{
+	return textureFormat != TextureFormat::rgba8;
+}
+
+//bytes of a width by height level, block compressed levels are padded out to whole blocks
+[[nodiscard]]
+inline size_t textureLevelBytes(const TextureFormat textureFormat, uint32_t width, uint32_t height)
+{
+	if (!isBlockCompressed(textureFormat)) return (size_t)width * height * textureFormatToBlockSize(textureFormat);
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * textureFormatToBlockSize(textureFormat);
+}
@@ -0,0 +1,112 @@
+#include "TextureSerialization.h"
+#pragma warning(disable : 26451)
+#include "Files.h"
+#include "Logger/Logger.h"
+#include "Serializer.h"
+#include "PayloadCompression.h"
+
+std::optional<TextureFile::Mapped> TextureFile::map(const char *path)
+{
+	std::optional<MappedFile> file = MappedFile::open(path);
+	if (!file.has_value())
+	{
+		return std::nullopt;
+	}
+
+	constexpr size_t fixedHeaderSize = sizeof(magic) + sizeof(formatVersion) + sizeof(TextureFormat) + sizeof(bool) + sizeof(uint32_t) * 2 + sizeof(size_t);
+	if (file->size() < fixedHeaderSize)
+	{
+		Logger::logErrorFormatted("%s is too small to be a .tex file", path);
+		return std::nullopt;
+	}
+
+	//the mapping is read only, StreamIn just doesn't know about const
+	StreamIn stream(const_cast<std::byte *>(file->data()), file->size());
+	const uint32_t fileMagic = stream.getNext<uint32_t>();
+	const uint32_t version = stream.getNext<uint32_t>();
+	if (fileMagic != magic || version != formatVersion)
+	{
+		Logger::logErrorFormatted("%s is not a version %u .tex file, it needs recompiling", path, formatVersion);
+		return std::nullopt;
+	}
+
+	Header header;
+	header.format = stream.getNext<TextureFormat>();
+	header.srgb = stream.getNext<bool>();
+	header.width = stream.getNext<uint32_t>();
+	header.height = stream.getNext<uint32_t>();
+
+	const size_t levelCount = stream.getNext<size_t>();
+	if (header.format > TextureFormat::bc7 || levelCount == 0 || levelCount > (file->size() - stream.bytesRead()) / sizeof(Level))
+	{
+		Logger::logErrorFormatted("%s has a corrupt header", path);
+		return std::nullopt;
+	}
+	header.levels.resize(levelCount);
+	stream.getNext(header.levels.data(), header.levels.size());
+
+	//the levels must tile the payload exactly, anything else would send the copy past the end of the mapping
+	size_t expectedOffset = 0;
+	for (const Level &level : header.levels)
+	{
+		if (level.offset != expectedOffset || level.size != textureLevelBytes(header.format, level.width, level.height))
+		{
+			Logger::logErrorFormatted("%s has a corrupt level table", path);
+			return std::nullopt;
+		}
+		expectedOffset += level.size;
+	}
+
+	const size_t chunkCount = payload::chunkCountFor(header.payloadBytes());
+	if (file->size() - stream.bytesRead() < sizeof(size_t) || stream.getNext<size_t>() != chunkCount
+		|| chunkCount * sizeof(uint32_t) > file->size() - stream.bytesRead())
+	{
+		Logger::logErrorFormatted("%s has a corrupt chunk table", path);
+		return std::nullopt;
+	}
+
+	std::vector<uint32_t> compressedSizes(chunkCount);
+	stream.getNext(compressedSizes.data(), compressedSizes.size());
+
+	std::vector<size_t> chunkOffsets(chunkCount + 1, stream.bytesRead());
+	for (size_t i = 0; i < chunkCount; i++) chunkOffsets[i + 1] = chunkOffsets[i] + compressedSizes[i];
+	if (chunkOffsets.back() > file->size())
+	{
+		Logger::logErrorFormatted("%s is truncated", path);
+		return std::nullopt;
+	}
+
+	return Mapped(std::move(file.value()), std::move(header), std::move(chunkOffsets));
+}
+
+bool TextureFile::Mapped::decompressPayload(std::byte *destination, ThreadPool *pool) const
+{
+	return payload::decompress(file.data(), chunkOffsets, fileHeader.payloadBytes(), destination, pool);
+}
+
+bool TextureFile::save(const char *path, const FileData &data, ThreadPool *pool, int compressionLevel)
+{
+	const Header &header = data.header;
+	StretchyStreamOut out = StretchyStreamOut();
+	out.setNext(magic);
+	out.setNext(formatVersion);
+	out.setNext(header.format);
+	out.setNext(header.srgb);
+	out.setNext(header.width);
+	out.setNext(header.height);
+	out.setNext(header.levels.size());
+	if (!header.levels.empty()) out.setNext(header.levels.data(), header.levels.size());
+
+	const std::optional<payload::Compressed> compressed = payload::compress(data.payload, pool, compressionLevel);
+	if (!compressed.has_value()) return false;
+	out.setNext(compressed->chunkSizes.size());
+	if (!compressed->chunkSizes.empty()) out.setNext(compressed->chunkSizes.data(), compressed->chunkSizes.size());
+
+	std::vector<std::byte> fileBytes(out.bytesWritten());
+	fileBytes.reserve(out.bytesWritten() + compressed->chunks.size());
+	memcpy(fileBytes.data(), out.getData(), out.bytesWritten());
+	fileBytes.insert(fileBytes.end(), compressed->chunks.begin(), compressed->chunks.end());
+
+	FileWriter writer(path);
+	return writer.writeVector(fileBytes);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "TextureFormat.h"
+#include "MappedFile.h"
+#include <optional>
+
+class ThreadPool;
+
+//a .tex file: a texture with its whole mip chain, already in the format the GPU samples
+//the levels are back to back in a payload compressed like the one of .o files, which decompresses straight into staging for one copy to the image
+class TextureFile
+{
+public:
+
+	static constexpr uint32_t magic = 0x58455454; //"TTEX"
+	static constexpr uint32_t formatVersion = 1;
+
+	//one mip level, levels are stored from the full size one down to 1x1
+	struct Level
+	{
+		size_t offset = {}; //into the payload, a multiple of the block size as vkCmdCopyBufferToImage wants
+		size_t size = {};
+		uint32_t width = {};
+		uint32_t height = {};
+	};
+
+	struct Header
+	{
+		TextureFormat format = TextureFormat::rgba8;
+		bool srgb = true; //false for data such as normal maps, which must not be gamma decoded
+		uint32_t width = {};
+		uint32_t height = {};
+		std::vector<Level> levels = {};
+
+		[[nodiscard]]
+		size_t payloadBytes() const { return levels.empty() ? 0 : levels.back().offset + levels.back().size; }
+		[[nodiscard]]
+		VkFormat vkFormat() const { return textureFormatToVkFormat(format, srgb); }
+	};
+
+	struct FileData
+	{
+		Header header = {};
+		std::vector<std::byte> payload = {};
+	};
+
+	//a mapped .tex whose payload hasn't been touched yet
+	class Mapped
+	{
+	public:
+
+		[[nodiscard]]
+		const Header &header() const { return fileHeader; }
+
+		//writes header().payloadBytes() bytes to destination, every level in the order of header().levels
+		[[nodiscard]]
+		bool decompressPayload(std::byte *destination, ThreadPool *pool = nullptr) const;
+
+	private:
+
+		friend class TextureFile;
+		Mapped(MappedFile &&givenFile, Header &&givenHeader, std::vector<size_t> &&givenChunkOffsets)
+			: file(std::move(givenFile)), fileHeader(std::move(givenHeader)), chunkOffsets(std::move(givenChunkOffsets)) {}
+
+		MappedFile file;
+		Header fileHeader;
+		std::vector<size_t> chunkOffsets; //where each chunk starts in the file, plus where the last one ends
+	};
+
+	[[nodiscard]]
+	static std::optional<Mapped> map(const char *path);
+	//compressionLevel is passed on to payload::compress
+	static bool save(const char *path, const FileData &data, ThreadPool *pool = nullptr, int compressionLevel = 0);
+};
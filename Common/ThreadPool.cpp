@@ -0,0 +1,169 @@
+#include "ThreadPool.h"
+#include <optional>
+
+namespace
+{
+	//which pool the current thread works for and which of its deques is its own, threads outside any pool never match
+	thread_local const ThreadPool *currentPool = nullptr;
+	thread_local size_t currentQueue = 0;
+}
+
+bool JobCounter::done() const
+{
+	std::scoped_lock lock(mutex);
+	return pending == 0;
+}
+
+ThreadPool::ThreadPool(size_t workerCount)
+{
+	queues.reserve(workerCount + 1);
+	for (size_t i = 0; i < workerCount + 1; i++)
+	{
+		queues.push_back(std::make_unique<JobQueue>());
+	}
+
+	workers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back([this, i]() { workerLoop(i); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock(sleepMutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+
+	for (std::thread &worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> &&job, JobCounter *counter)
+{
+	if (counter != nullptr)
+	{
+		std::scoped_lock lock(counter->mutex);
+		counter->pending++;
+	}
+	push(Job{ .function = std::move(job), .counter = counter });
+}
+
+void ThreadPool::submitAfter(JobCounter &dependency, std::function<void()> &&job, JobCounter *counter)
+{
+	if (counter != nullptr)
+	{
+		std::scoped_lock lock(counter->mutex);
+		counter->pending++;
+	}
+
+	{
+		std::scoped_lock lock(dependency.mutex);
+		if (dependency.pending != 0)
+		{
+			dependency.continuations.push_back({ .job = std::move(job), .counter = counter });
+			return;
+		}
+	}
+	push(Job{ .function = std::move(job), .counter = counter });
+}
+
+void ThreadPool::wait(const JobCounter &counter)
+{
+	while (!counter.done())
+	{
+		if (!tryRunJob()) std::this_thread::yield();
+	}
+}
+
+size_t ThreadPool::defaultWorkerCount()
+{
+	const size_t hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void ThreadPool::workerLoop(size_t queueIndex)
+{
+	currentPool = this;
+	currentQueue = queueIndex;
+
+	while (true)
+	{
+		if (tryRunJob()) continue;
+
+		std::unique_lock lock(sleepMutex);
+		jobAvailable.wait(lock, [this]() { return stopping || queuedJobs > 0; });
+		if (stopping && queuedJobs == 0) return;
+	}
+}
+
+void ThreadPool::push(Job &&job)
+{
+	//a worker keeps what it submits, it's likely to touch what the worker just did, everyone else deals them out in turn
+	const size_t queueIndex = currentPool == this ? currentQueue : nextQueue++ % queues.size();
+
+	//counted before it's pushed so the count never drops below what's queued, a worker woken early just looks again
+	{
+		std::scoped_lock lock(sleepMutex);
+		queuedJobs++;
+	}
+	{
+		JobQueue &queue = *queues[queueIndex];
+		std::scoped_lock lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+bool ThreadPool::tryRunJob()
+{
+	if (queuedJobs == 0) return false;
+
+	//a worker's own deque from the back, then everyone's from the front starting at the next one, so thieves spread out
+	const bool worker = currentPool == this;
+	const size_t ownQueue = worker ? currentQueue : queues.size() - 1;
+	std::optional<Job> job;
+	for (size_t i = 0; i < queues.size() && !job.has_value(); i++)
+	{
+		JobQueue &queue = *queues[(ownQueue + i) % queues.size()];
+		std::scoped_lock lock(queue.mutex);
+		if (queue.jobs.empty()) continue;
+
+		if (worker && i == 0)
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+		}
+		else
+		{
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+		}
+	}
+	if (!job.has_value()) return false;
+
+	queuedJobs--;
+	job->function();
+	if (job->counter != nullptr) finish(*job->counter);
+	return true;
+}
+
+void ThreadPool::finish(JobCounter &counter)
+{
+	std::vector<JobCounter::Continuation> continuations;
+	{
+		std::scoped_lock lock(counter.mutex);
+		if (--counter.pending != 0) return;
+		continuations.swap(counter.continuations);
+	}
+
+	//the counter may be gone by now, the continuations were moved out first
+	for (JobCounter::Continuation &continuation : continuations)
+	{
+		push(Job{ .function = std::move(continuation.job), .counter = continuation.counter });
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CommonConcepts.h"
+
+//counts the jobs submitted with it that haven't finished yet, ThreadPool::wait runs other jobs until it gets back to zero
+//has to outlive every job counted by it, and every job waiting on it through submitAfter
+class JobCounter
+{
+public:
+
+	JobCounter() = default;
+	JobCounter(const JobCounter &) = delete;
+	JobCounter &operator=(const JobCounter &) = delete;
+
+	[[nodiscard]]
+	bool done() const;
+
+private:
+
+	friend class ThreadPool;
+
+	struct Continuation
+	{
+		std::function<void()> job;
+		JobCounter *counter;
+	};
+
+	mutable std::mutex mutex; //held while finishing a job, so a waiter can't see zero and destroy the counter while it's still being touched
+	size_t pending = 0;
+	std::vector<Continuation> continuations; //submitted once pending gets back to zero
+};
+
+//every worker has a deque of jobs it pushes to and pops from at the back, and steals from the front of the others' once its own is empty
+//jobs submitted from outside the pool are handed to the deques in turn, so no one lock is shared by every submission
+class ThreadPool
+{
+public:
+
+	//workerCount doesn't include the calling thread, which helps out during parallelFor and wait
+	ThreadPool(size_t workerCount = defaultWorkerCount());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	void submit(std::function<void()> &&job, JobCounter *counter = nullptr);
+
+	//submits job once every job counted by dependency has finished, counter counts it from now rather than from then
+	void submitAfter(JobCounter &dependency, std::function<void()> &&job, JobCounter *counter = nullptr);
+
+	//runs queued jobs on the calling thread until counter is done, so waiting from a job or the main thread never leaves a core idle or deadlocks
+	void wait(const JobCounter &counter);
+
+	//runs function(begin, end) over consecutive ranges of up to grainSize indices covering [0, count), across the workers and the calling thread
+	//returns once all of them are done, the ranges are handed out one at a time so uneven ones balance out
+	template<con::InvocableWith<size_t, size_t> Function_t>
+	void parallelForRanges(size_t count, size_t grainSize, Function_t &&function)
+	{
+		assert(grainSize > 0);
+		if (count == 0) return;
+
+		const size_t rangeCount = (count + grainSize - 1) / grainSize;
+		std::atomic<size_t> next = 0;
+		auto work = [&]()
+		{
+			for (size_t range = next++; range < rangeCount; range = next++)
+			{
+				const size_t begin = range * grainSize;
+				function(begin, begin + grainSize < count ? begin + grainSize : count);
+			}
+		};
+
+		const size_t helperCount = rangeCount - 1 < workers.size() ? rangeCount - 1 : workers.size();
+		JobCounter helpersDone;
+		for (size_t i = 0; i < helperCount; i++)
+		{
+			submit([&work]() { work(); }, &helpersDone);
+		}
+
+		work();
+		wait(helpersDone);
+	}
+
+	//runs function(i) for every i in [0, count) across the workers and the calling thread, returns once all of them are done
+	template<con::InvocableWith<size_t> Function_t>
+	void parallelFor(size_t count, Function_t &&function)
+	{
+		parallelForRanges(count, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				function(i);
+			}
+		});
+	}
+
+	[[nodiscard]]
+	size_t workerCount() const { return workers.size(); }
+
+	[[nodiscard]]
+	static size_t defaultWorkerCount();
+
+private:
+
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter *counter;
+	};
+
+	struct JobQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void workerLoop(size_t queueIndex);
+	void push(Job &&job);
+	bool tryRunJob();
+	void finish(JobCounter &counter);
+
+	//one per worker, and one more that only gets stolen from, so a pool without workers still has somewhere to put jobs
+	std::vector<std::unique_ptr<JobQueue>> queues;
+	std::atomic<size_t> nextQueue = 0;
+
+	std::vector<std::thread> workers;
+	std::atomic<size_t> queuedJobs = 0;
+	std::mutex sleepMutex;
+	std::condition_variable jobAvailable;
+	bool stopping = false;
+};
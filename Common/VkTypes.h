@@ -24,4 +24,5 @@ struct BufferSpan
 struct Texture {
     AllocatedImage image;
     VkImageView imageView;
+    VkSampler sampler; //owned by the sampler cache
 };
\ No newline at end of file
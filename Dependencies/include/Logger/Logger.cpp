@@ -1,6 +1,7 @@
 #include "Logger.h"
 #include <iostream>
 #include <cstdarg>
+#include <mutex>
 
 #ifdef NDEBUG
 	Logger::Verbosity Logger::verbosity = Logger::Verbosity::WARNING;
@@ -36,6 +37,10 @@
 
 #define CHECK_VERBOSITY(against) if(verbosity < against) return;
 
+//the asset compiler logs from worker threads, this keeps their lines from interleaving
+static std::mutex logMutex;
+#define LOCK_LOG std::scoped_lock logLock(logMutex);
+
 
 
 #define LOG(prefix, message) std::cout << "[" << prefix << "] " << message << '\n'; RESET_COLOR
@@ -58,45 +63,45 @@ void Logger::setVerbosity(Verbosity givenVerbosity)
 void Logger::logMessage(const char *message)
 {
 	CHECK_VERBOSITY(Logger::Verbosity::MESSAGE);
-	COLOR_MESSAGE LOG("message", message);
+	LOCK_LOG COLOR_MESSAGE LOG("message", message);
 }
 
 void Logger::logMessageFormatted(const char * const format, ...)
 {
 	CHECK_VERBOSITY(Logger::Verbosity::MESSAGE);
-	COLOR_MESSAGE LOG_FORMATTED("message", format);
+	LOCK_LOG COLOR_MESSAGE LOG_FORMATTED("message", format);
 }
 
 void Logger::logError(const char *error)
 {
-	COLOR_ERROR LOG("error!!!", error);
+	LOCK_LOG COLOR_ERROR LOG("error!!!", error);
 }
 
 void Logger::logErrorFormatted(const char *format, ...)
 {
-	COLOR_ERROR LOG_FORMATTED("error!!!", format);
+	LOCK_LOG COLOR_ERROR LOG_FORMATTED("error!!!", format);
 }
 void Logger::logWarning(const char *message)
 {
 	CHECK_VERBOSITY(Logger::Verbosity::WARNING);
 
-	COLOR_WARNING LOG("warning!", message);
+	LOCK_LOG COLOR_WARNING LOG("warning!", message);
 }
 
 void Logger::logWarningFormatted(const char *format, ...)
 {
 	CHECK_VERBOSITY(Logger::Verbosity::WARNING); 
-	COLOR_WARNING LOG_FORMATTED("warning!", format);
+	LOCK_LOG COLOR_WARNING LOG_FORMATTED("warning!", format);
 }
 
 void Logger::logTrivial(const char *message)
 {
 	CHECK_VERBOSITY(Logger::Verbosity::TRIVIAL);
-	COLOR_TRIVIAL LOG("trivial", message);
+	LOCK_LOG COLOR_TRIVIAL LOG("trivial", message);
 }
 
 void Logger::logTrivialFormatted(const char *format, ...)
 {
 	CHECK_VERBOSITY(Logger::Verbosity::TRIVIAL);
-	COLOR_TRIVIAL LOG_FORMATTED("trivial", format);
+	LOCK_LOG COLOR_TRIVIAL LOG_FORMATTED("trivial", format);
 }
\ No newline at end of file
@@ -99,7 +99,7 @@ class StretchyStreamOut
 {
 public:
 
-	StretchyStreamOut(size_t expectedSize = 0) : data(expectedSize) {}
+	StretchyStreamOut(size_t expectedSize = 0) { data.reserve(expectedSize); }
 
 	template<typename T>
 	void setNext(const T &item) noexcept
@@ -117,7 +117,7 @@ public:
 		const size_t at = data.size();
 		const size_t size = sizeof(T) * amount;
 		data.resize(data.size() + size);
-		memcpy(data.data(), items, size);
+		memcpy(data.data() + at, items, size);
 	}
 
 	[[nodiscard]]
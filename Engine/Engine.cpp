@@ -6,6 +6,8 @@
 #include "Logger/Logger.h"
 #include "OFileSerialization.h"
 #include <array>
+#include <algorithm>
+#include <tuple>
 #include <MathUtils.h>
 #include <CommonConcepts.h>
 #include <MemoryUtils.h>
@@ -30,6 +32,101 @@ namespace
     std::string getShaderPath(const char *shaderName) { return (std::string(assetsFolderPath) + "shaders/") + shaderName; }
     std::string getModelPath(const char *modelName) { return (std::string(assetsFolderPath) + "models/") + modelName; }
 
+    //how many pixels a level of detail's surface may stray from the full detail one before a finer level is drawn
+    ConsoleVariable<float> lodErrorPixels("lodErrorPixels", 1.0f);
+
+    //cull and pick levels of detail in a compute pass and draw indirect, rather than doing both for every object in drawObjects
+    ConsoleVariable<bool> gpuDrivenRendering("gpuDrivenRendering", true);
+
+    constexpr uint32_t cullWorkgroupSize = 64; //local_size_x in cull.comp
+
+    //below this many instanced draws per secondary command buffer, spreading the recording across threads costs more than it saves
+    constexpr size_t minDrawsPerSecondary = 64;
+
+    [[nodiscard]]
+    mat4x4::PerspectiveProjection cameraProjection(VkExtent2D extent)
+    {
+        return mat4x4::PerspectiveProjection
+        {
+            .fovX = math::degToRad(70.0f),
+            .aspectRatio = extent.width / static_cast<float>(extent.height),
+            .zfar = 200.0f,
+            .znear = .01f,
+        };
+    }
+
+    //pixels covered by one unit one unit away from the camera, across the width of the window
+    [[nodiscard]]
+    float pixelsPerUnitAtOne(VkExtent2D extent, const mat4x4::PerspectiveProjection &projection)
+    {
+        return extent.width / (2.0f * tanf(projection.fovX * 0.5f));
+    }
+
+    struct IndexRange
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+
+    //one object with the level of detail picked for it this frame
+    struct DrawItem
+    {
+        const RenderObject *object;
+        IndexRange lod;
+
+        //same material, mesh and indices, so both can be drawn as instances of one draw
+        bool drawsLike(const DrawItem &other) const
+        {
+            return object->material == other.object->material
+                && object->mesh == other.object->mesh
+                && lod.firstIndex == other.lod.firstIndex
+                && lod.indexCount == other.lod.indexCount;
+        }
+    };
+
+    //a submesh's bounding sphere in world space
+    struct WorldBounds
+    {
+        vec3 center;
+        float radius;
+        float scale; //the largest of the transform, which the errors of the levels of detail grow with too
+    };
+
+    [[nodiscard]]
+    WorldBounds worldBounds(const OFile::Submesh &submesh, const mat4x4 &transform)
+    {
+        //the bounds are in model units, so the radius grows with the largest scale of the transform
+        const float scale = std::max({ transform.columnAt(0).xyz().length(), transform.columnAt(1).xyz().length(), transform.columnAt(2).xyz().length() });
+        const vec3 &sphereCenter = submesh.bounds.center;
+        return WorldBounds
+        {
+            .center = (transform * vec4(sphereCenter.x(), sphereCenter.y(), sphereCenter.z(), 1.0f)).xyz(),
+            .radius = submesh.bounds.radius * scale,
+            .scale = scale
+        };
+    }
+
+    //the coarsest level whose error, projected from the nearest point of the submesh's bounding sphere, stays under lodErrorPixels
+    [[nodiscard]]
+    IndexRange selectLod(const OFile &data, uint32_t submeshIndex, const WorldBounds &bounds, vec3 eye, float pixelsPerUnitAtOne, float znear)
+    {
+        const OFile::Submesh &submesh = data.submeshes()[submeshIndex];
+        const IndexRange fullDetail{ .firstIndex = submesh.firstIndex, .indexCount = submesh.indexCount };
+        if (submesh.lodCount == 0) return fullDetail;
+
+        const float distance = std::max((bounds.center - eye).length() - bounds.radius, znear);
+        const float pixelsPerUnit = pixelsPerUnitAtOne / distance * bounds.scale;
+
+        IndexRange selected = fullDetail;
+        for (uint32_t level = 0; level < submesh.lodCount; level++)
+        {
+            const OFile::Lod &lod = data.lods()[submesh.firstLod + level];
+            if (lod.error * pixelsPerUnit > lodErrorPixels.get()) break;
+            selected = IndexRange{ .firstIndex = lod.firstIndex, .indexCount = lod.indexCount };
+        }
+        return selected;
+    }
+
     [[nodiscard]]
     VkSurfaceKHR createSurface(VkInstance instance, Window &window)
     {
@@ -98,7 +195,7 @@ MaterialHandle Engine::createMaterial(VkPipeline pipeline, VkPipelineLayout layo
         //write to the descriptor set so that it points to our empire_diffuse texture
         const VkDescriptorImageInfo imageInfo
         {
-            .sampler = blockySampler,
+            .sampler = texture->sampler,
             .imageView = texture->imageView,
             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
         };
@@ -158,16 +255,152 @@ Mesh *Engine::getMesh(MeshHandle handle)
 void Engine::drawObjects(VkCommandBuffer cmd, RenderObject *first, size_t objectCount, const Camera& camera)
 {
     FrameData &frame = currentFrame();
+    const GPUCameraData cameraData = uploadCameraData(camera);
+    const mat4x4::PerspectiveProjection perspectiveProjection = cameraProjection(windowExtent);
+    const float pixelsPerUnit = pixelsPerUnitAtOne(windowExtent, perspectiveProjection);
+
+    //cull against the frustum first, so only what can be seen gets a level of detail, a slot in the objects buffer and a draw
+    std::vector<WorldBounds> bounds;
+    bounds.reserve(objectCount);
+    cullingSpheres.clear();
+    cullingSpheres.reserve(objectCount);
+    for (size_t i = 0; i < objectCount; i++)
+    {
+        const RenderObject &object = first[i];
+        bounds.push_back(worldBounds(object.mesh->data.submeshes()[object.submesh], object.transform));
+        cullingSpheres.push(bounds.back().center, bounds.back().radius);
+    }
+    visibleRenderables.clear();
+    cullSpheres(extractFrustumPlanes(cameraData.viewProjection), cullingSpheres, visibleRenderables);
+
+    std::vector<DrawItem> drawItems;
+    drawItems.reserve(visibleRenderables.size());
+    for (const uint32_t i : visibleRenderables)
+    {
+        const RenderObject &object = first[i];
+        drawItems.push_back({ .object = &object, .lod = selectLod(object.mesh->data, object.submesh, bounds[i], camera.position, pixelsPerUnit, perspectiveProjection.znear) });
+    }
+
+    //renderables are sorted by pipeline and mesh, so sorting each of those runs by material and level of detail
+    //puts every object that can share an instanced draw next to each other without changing the order of pipelines
+    for (auto runStart = drawItems.begin(); runStart != drawItems.end();)
+    {
+        const auto runEnd = std::find_if(runStart, drawItems.end(), [&](const DrawItem &item)
+        {
+            return item.object->mesh != runStart->object->mesh || item.object->material->pipeline != runStart->object->material->pipeline;
+        });
+        std::sort(runStart, runEnd, [](const DrawItem &a, const DrawItem &b)
+        {
+            return std::make_tuple(std::uintptr_t(a.object->material), a.lod.firstIndex, a.lod.indexCount) < std::make_tuple(std::uintptr_t(b.object->material), b.lod.firstIndex, b.lod.indexCount);
+        });
+        runStart = runEnd;
+    }
+
+    //slightly more complex than uploadToGPU, essentially copying the transforms of the objects to the mapped pointer, in the order they're drawn
+    void *objectData = vkmem::getMappedData(frame.objectsBuffer);
+    for (size_t i = 0; i < drawItems.size(); i++)
+    {
+        const RenderObject &object = *drawItems[i].object;
+        //quantised positions are dequantised by the model matrix, so the shader doesn't need to know about them
+        const mat4x4 modelMatrix = object.mesh->data.hasQuantisedPositions() ? object.transform * object.mesh->data.positionDequantisation() : object.transform;
+        static_cast<GPUObjectData *>(objectData)[i] = { .modelMatrix = modelMatrix, .color = object.color };
+    }
+
+    //where each instanced draw starts, with the end of the last one at the back
+    std::vector<size_t> batchStarts;
+    for (size_t batchStart = 0; batchStart < drawItems.size(); batchStart++)
+    {
+        if (batchStart == 0 || !drawItems[batchStart].drawsLike(drawItems[batchStart - 1])) batchStarts.push_back(batchStart);
+    }
+    const size_t batchCount = batchStarts.size();
+    batchStarts.push_back(drawItems.size());
+
+    //the draws are split into runs recorded across the pool, each into its own secondary command buffer, which is only worth it once there are enough of them
+    const size_t chunkCount = std::min(frame.objectCommands.size(), (batchCount + minDrawsPerSecondary - 1) / minDrawsPerSecondary);
+    threadPool.parallelFor(chunkCount, [&](size_t chunk)
+    {
+        const VkCommandBuffer secondary = beginSecondary(frame.objectCommands[chunk]);
+
+        //secondaries don't inherit any state, so each one binds its first material and mesh again
+        Mesh* lastMesh = nullptr;
+        Material* lastMaterial = nullptr;
+        for (size_t batchIndex = chunk * batchCount / chunkCount; batchIndex < (chunk + 1) * batchCount / chunkCount; batchIndex++)
+        {
+            const size_t batchStart = batchStarts[batchIndex];
+            const size_t batchEnd = batchStarts[batchIndex + 1];
+            const DrawItem &batch = drawItems[batchStart];
+            const RenderObject& object = *batch.object;
+
+            //only bind the pipeline if it doesnt match with the already bound one
+            if (object.material != lastMaterial) 
+            {
+                bindMaterial(secondary, *object.material, frame.objectsDescriptor);
+                lastMaterial = object.material;
+            }
+
+            //only bind the mesh if its a different one from last bind
+            if (object.mesh != lastMesh) {
+                bindMesh(secondary, *object.mesh);
+                lastMesh = object.mesh;
+            }
+
+            //the shader reads the object data at gl_InstanceIndex, which counts up from firstInstance across the batch
+            vkCmdDrawIndexed(secondary, batch.lod.indexCount, static_cast<uint32_t>(batchEnd - batchStart), batch.lod.firstIndex, 0, static_cast<uint32_t>(batchStart));
+        }
+
+        VK_CHECK(vkEndCommandBuffer(secondary));
+    });
+
+    std::vector<VkCommandBuffer> secondaries;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) secondaries.push_back(frame.objectCommands[chunk].buffer);
+    if (!secondaries.empty()) vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
+VkCommandBuffer Engine::beginSecondary(const SecondaryCommands &commands)
+{
+    //the frame's fence has been waited on, so nothing recorded into the pool last time is still in use
+    VK_CHECK(vkResetCommandPool(device, commands.pool, 0));
+
+    const VkCommandBufferInheritanceInfo inheritanceInfo
+    {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = renderPass,
+        .subpass = 0,
+        .framebuffer = framebuffers[swapchainInfo.lastAcquiredImageIndex],
+    };
+    const VkCommandBufferBeginInfo beginInfo
+    {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo,
+    };
+    VK_CHECK(vkBeginCommandBuffer(commands.buffer, &beginInfo));
+
+    //dynamic state isn't inherited from the primary either
+    const VkViewport viewport
+    {
+        .x = .0f,
+        .y = .0f,
+        .width = static_cast<float>(windowExtent.width),
+        .height = static_cast<float>(windowExtent.height),
+        .minDepth = .0f,
+        .maxDepth = 1.0f
+    };
+    const VkRect2D scissor
+    {
+        .offset = {0,0},
+        .extent = windowExtent
+    };
+    vkCmdSetViewport(commands.buffer, 0, 1, &viewport);
+    vkCmdSetScissor(commands.buffer, 0, 1, &scissor);
+
+    return commands.buffer;
+}
+
+GPUCameraData Engine::uploadCameraData(const Camera &camera)
+{
     const mat4x4 viewMatrix = camera.calculateViewMatrix();
-    
-    const mat4x4::PerspectiveProjection perspectiveProjection
-    {
-        .fovX = math::degToRad(70.0f),
-        .aspectRatio = windowExtent.width / static_cast<float>(windowExtent.height),
-        .zfar = 200.0f,
-        .znear = .01f,
-    }; 
-    mat4x4 projectionMatrix = mat4x4::perspective(perspectiveProjection);
+    mat4x4 projectionMatrix = mat4x4::perspective(cameraProjection(windowExtent));
     projectionMatrix.at(1, 1) *= -1.0f;
 
     const GPUCameraData cameraData
@@ -177,49 +410,120 @@ void Engine::drawObjects(VkCommandBuffer cmd, RenderObject *first, size_t object
         .viewProjection = projectionMatrix * viewMatrix
     };
 
+    vkmem::uploadToBuffer<GPUCameraData>({ .data = &cameraData, .buffer = globalBuffer, .offset = cameraDataOffset(currentFrameIndex()) });
+    return cameraData;
+}
+
+void Engine::bindMaterial(VkCommandBuffer cmd, const Material &material, VkDescriptorSet objectsDescriptor)
+{
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipeline);
+
     const uint32_t cameraOffset = cameraDataOffset(currentFrameIndex());
-    vkmem::uploadToBuffer<GPUCameraData>({ .data = &cameraData, .buffer = globalBuffer, .offset = cameraOffset});
+    const uint32_t uniformOffset = static_cast<uint32_t>(sceneDataOffset(currentFrameIndex()));
+    const std::array<uint32_t, 2> offsets = {cameraOffset, uniformOffset};
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipelineLayout, 0, 1, &globalDescriptorSet,static_cast<uint32_t>(offsets.size()), offsets.data());
+    
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipelineLayout, 1, 1, &objectsDescriptor, 0, nullptr); 
+    if (material.textureSet != VK_NULL_HANDLE) {
+        //texture descriptor
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, material.pipelineLayout, 2, 1, &material.textureSet, 0, nullptr);
+    }
+}
 
-    //slightly more complex than uploadToGPU, essentially copying the transforms of the objects to the mapped pointer
-    void *objectData = vkmem::getMappedData(frame.objectsBuffer);
-    for (int i = 0; i < objectCount; i++)
+void Engine::bindMesh(VkCommandBuffer cmd, const Mesh &mesh)
+{
+    mesh.bindVertexBuffers(cmd);
+    vkCmdBindIndexBuffer(cmd, mesh.indexBuffer.buffer, 0, indexTypeToVkIndexType(mesh.data.indexType()));
+}
+
+bool Engine::useGPUDrivenRendering() const
+{
+    return cullPipeline != VK_NULL_HANDLE && gpuDrivenRendering.get();
+}
+
+void Engine::cullObjects(VkCommandBuffer cmd, const Camera &camera)
+{
+    if (gpuDrivenScene.objectCount == 0) return;
+
+    FrameData &frame = currentFrame();
+    const GPUCameraData cameraData = uploadCameraData(camera);
+
+    //every command starts with no instances and every group with no draws
+    const VkBufferCopy commandsCopy{ .size = sizeof(VkDrawIndexedIndirectCommand) * gpuDrivenScene.commandCount };
+    vkCmdCopyBuffer(cmd, gpuDrivenScene.commandTemplateBuffer.buffer, frame.drawCommandsBuffer.buffer, 1, &commandsCopy);
+    vkCmdFillBuffer(cmd, frame.drawCountsBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+    const VkMemoryBarrier resetToCull
     {
-        const RenderObject &object = first[i];
-        static_cast<GPUObjectData *>(objectData)[i] = { .modelMatrix = object.transform, .color = object.color };
-    }
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &resetToCull, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullDescriptor, 0, nullptr);
+
+    const mat4x4::PerspectiveProjection perspectiveProjection = cameraProjection(windowExtent);
+    GPUCullParameters parameters
+    {
+        .frustumPlanes = extractFrustumPlanes(cameraData.viewProjection),
+        .eye = vec4(camera.position.x(), camera.position.y(), camera.position.z(), perspectiveProjection.znear),
+        .lodThreshold = lodErrorPixels.get() / pixelsPerUnitAtOne(windowExtent, perspectiveProjection),
+        .objectCount = gpuDrivenScene.objectCount,
+        .commandCount = gpuDrivenScene.commandCount,
+        .phase = 0
+    };
+    vkCmdPushConstants(cmd, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCullParameters), &parameters);
+    vkCmdDispatch(cmd, (gpuDrivenScene.objectCount + cullWorkgroupSize - 1) / cullWorkgroupSize, 1, 1);
+
+    //the commands need every instance counted before they can be compacted
+    const VkMemoryBarrier cullToCompact
+    {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cullToCompact, 0, nullptr, 0, nullptr);
+
+    parameters.phase = 1;
+    vkCmdPushConstants(cmd, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCullParameters), &parameters);
+    vkCmdDispatch(cmd, (gpuDrivenScene.commandCount + cullWorkgroupSize - 1) / cullWorkgroupSize, 1, 1);
+
+    const VkMemoryBarrier compactToDraw
+    {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+    };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &compactToDraw, 0, nullptr, 0, nullptr);
+}
+
+void Engine::drawObjectsIndirect(VkCommandBuffer cmd)
+{
+    FrameData &frame = currentFrame();
 
     Mesh* lastMesh = nullptr;
     Material* lastMaterial = nullptr;
-    for (int i = 0; i < objectCount; i++)
+    for (size_t i = 0; i < gpuDrivenScene.groups.size(); i++)
     {
-        const RenderObject& object = first[i];
-
-        //only bind the pipeline if it doesnt match with the already bound one
-        if (object.material != lastMaterial) 
+        const IndirectDrawGroup &group = gpuDrivenScene.groups[i];
+        if (group.material != lastMaterial) 
         {
-            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipeline);
-            lastMaterial = object.material;
-
-            const uint32_t uniformOffset = static_cast<uint32_t>(sceneDataOffset(currentFrameIndex()));
-            const std::array<uint32_t, 2> offsets = {cameraOffset, uniformOffset};
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout, 0, 1, &globalDescriptorSet,static_cast<uint32_t>(offsets.size()), offsets.data());
-            
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout, 1, 1, &frame.objectsDescriptor, 0, nullptr); 
-            if (object.material->textureSet != VK_NULL_HANDLE) {
-                //texture descriptor
-                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout, 2, 1, &object.material->textureSet, 0, nullptr);
-            }
+            bindMaterial(cmd, *group.material, frame.visibleObjectsDescriptor);
+            lastMaterial = group.material;
         }
 
-        //only bind the mesh if its a different one from last bind
-        if (object.mesh != lastMesh) {
-            const VkDeviceSize vertexBufferOffset = 0;
-            vkCmdBindVertexBuffers(cmd, 0, 1, &object.mesh->vertexBuffer.buffer, &vertexBufferOffset);
-            vkCmdBindIndexBuffer(cmd, object.mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-            lastMesh = object.mesh;
+        if (group.mesh != lastMesh) {
+            bindMesh(cmd, *group.mesh);
+            lastMesh = group.mesh;
         }
 
-        vkCmdDrawIndexed(cmd, static_cast<uint32_t>(object.mesh->data.indices().size()), 1, 0, 0, i); //i is passed as firstInstance for the gl_BaseInstance trick
+        //the cull pass wrote how many of the group's commands got any instances, and packed those to the front of its range
+        vkCmdDrawIndexedIndirectCount(cmd, 
+            frame.compactedCommandsBuffer.buffer, group.firstCommand * sizeof(VkDrawIndexedIndirectCommand),
+            frame.drawCountsBuffer.buffer, i * sizeof(uint32_t),
+            group.maxCommands, sizeof(VkDrawIndexedIndirectCommand));
     }
 }
 
@@ -244,6 +548,7 @@ Engine::Engine(Window& givenWindow) : window(givenWindow)
     initFramebuffers();
     initSyncPrimitives();
     initDescriptors();
+    initCulling();
     initImgui();
     Logger::logMessage("Successfully initialized vulkan resources!");
 
@@ -328,6 +633,9 @@ void Engine::endRecording(FrameData& frame)
 
 void Engine::drawToScreen(Time deltaTime, const Camera& camera)
 {
+    //before anything is recorded, the rebuild waits for the frames in flight and can't wait on one whose fence was just reset
+    if (useGPUDrivenRendering() && gpuDrivenScene.dirty) rebuildGPUDrivenScene();
+
     FrameData &frame = currentFrame();
     getNextImage(frame.presentSemaphore);
     startRecording(frame.mainCommandBuffer, frame.renderFence);
@@ -377,11 +685,27 @@ void Engine::drawToScreen(Time deltaTime, const Camera& camera)
             .pClearValues = clearValues.data(),
         };
 
-        vkCmdBeginRenderPass(frame.mainCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        //the cull pass' dispatches and barriers can't be recorded inside the render pass
+        const bool gpuDriven = useGPUDrivenRendering();
+        if (gpuDriven) cullObjects(frame.mainCommandBuffer, camera);
+
+        //drawObjects records into secondary command buffers, and a subpass' commands either all come from secondaries or are all inline
+        const VkSubpassContents subpassContents = gpuDriven ? VK_SUBPASS_CONTENTS_INLINE : VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+        vkCmdBeginRenderPass(frame.mainCommandBuffer, &renderPassBeginInfo, subpassContents);
+        if (gpuDriven)
         {
-            drawObjects(frame.mainCommandBuffer, renderables.data(), renderables.size(), camera);
+            drawObjectsIndirect(frame.mainCommandBuffer);
             ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frame.mainCommandBuffer);
         }
+        else
+        {
+            drawObjects(frame.mainCommandBuffer, renderables.data(), renderables.size(), camera);
+
+            const VkCommandBuffer uiCommandBuffer = beginSecondary(frame.uiCommands);
+            ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), uiCommandBuffer);
+            VK_CHECK(vkEndCommandBuffer(uiCommandBuffer));
+            vkCmdExecuteCommands(frame.mainCommandBuffer, 1, &uiCommandBuffer);
+        }
         vkCmdEndRenderPass(frame.mainCommandBuffer);
     }
 
@@ -527,6 +851,13 @@ void Engine::initVulkan()
         .require_dedicated_transfer_queue()
         .prefer_gpu_device_type(vkb::PreferredDeviceType::discrete)
         .require_present()
+        .set_required_features(VkPhysicalDeviceFeatures
+        { 
+            .multiDrawIndirect = VK_TRUE,
+            .drawIndirectFirstInstance = VK_TRUE, //the cull pass points every command at its own range of visible objects
+            .samplerAnisotropy = VK_TRUE,
+            .textureCompressionBC = VK_TRUE //compiled textures are bc compressed
+        })
         .select();
 
     VKB_CHECK(physicalDeviceResult, "Failed to select Vulkan Physical Device");
@@ -534,7 +865,19 @@ void Engine::initVulkan()
     const vkb::PhysicalDevice vkbPhysicalDevice = physicalDeviceResult.value();
     physicalDevice = vkbPhysicalDevice.physical_device;
     
-    const vkb::DeviceBuilder deviceBuilder{ vkbPhysicalDevice };
+    //drawing indirect with a count is optional, without it everything is culled and drawn by drawObjects
+    VkPhysicalDeviceVulkan12Features supportedVulkan12Features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    VkPhysicalDeviceFeatures2 supportedFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supportedVulkan12Features };
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+    drawIndirectCountSupported = supportedVulkan12Features.drawIndirectCount == VK_TRUE;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features
+    {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .drawIndirectCount = supportedVulkan12Features.drawIndirectCount
+    };
+    vkb::DeviceBuilder deviceBuilder{ vkbPhysicalDevice };
+    deviceBuilder.add_pNext(&vulkan12Features);
     const auto deviceResult = deviceBuilder.build();
     VKB_CHECK(deviceResult, "Failed to create Vulkan device");
     const vkb::Device vkbDevice = deviceResult.value();
@@ -639,6 +982,14 @@ void Engine::initCommands()
             .commandBufferCount = 1,
         };
         VK_CHECK(vkAllocateCommandBuffers(device, &commandBufferAllocationInfo, &frame.mainCommandBuffer));
+
+        //a pool per secondary rather than per thread, since parallelFor doesn't say which thread records which, but only one ever records into a pool at a time
+        frame.objectCommands.resize(threadPool.workerCount() + 1);
+        for (SecondaryCommands &commands : frame.objectCommands)
+        {
+            commands = createSecondaryCommands();
+        }
+        frame.uiCommands = createSecondaryCommands();
     }
 
     const VkCommandPoolCreateInfo uploadCommandPoolInfo =
@@ -650,6 +1001,30 @@ void Engine::initCommands()
     QUEUE_DESTROY(vkDestroyCommandPool(device, uploadCommandPool, nullptr););
 }
 
+SecondaryCommands Engine::createSecondaryCommands()
+{
+    //reset as a whole every frame, so the buffer doesn't need resetting on its own
+    const VkCommandPoolCreateInfo poolInfo
+    {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = graphicsQueueFamily,
+    };
+    SecondaryCommands commands{};
+    VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &commands.pool));
+    QUEUE_DESTROY(vkDestroyCommandPool(device, commands.pool, nullptr));
+
+    const VkCommandBufferAllocateInfo allocationInfo
+    {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = commands.pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = 1,
+    };
+    VK_CHECK(vkAllocateCommandBuffers(device, &allocationInfo, &commands.buffer));
+    return commands;
+}
+
 void Engine::initDefaultRenderpass()
 {
     const VkAttachmentDescription colorAttachment
@@ -770,10 +1145,28 @@ MaterialHandle Engine::loadMaterial(const char *vertexModuleName, const char *fr
     const VkPipelineLayout pipelineLayout = vkut::createPipelineLayout(device, { globalSetLayout, objectsSetLayout, singleTextureSetLayout }, {});
     QUEUE_DESTROY(vkut::destroyPipelineLayout(device, pipelineLayout));
 
-    const std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {
+    //constant_id 0 in the vertex shader tells it whether normals come in octahedral encoded
+    const std::vector<AttributeType> &vertexAttributes = vertexMesh->data.attributes();
+    const VkBool32 octahedralNormals = std::find(vertexAttributes.begin(), vertexAttributes.end(), AttributeType::octahedral16) != vertexAttributes.end();
+    const VkSpecializationMapEntry octahedralNormalsEntry
+    {
+        .constantID = 0,
+        .offset = 0,
+        .size = sizeof(VkBool32)
+    };
+    const VkSpecializationInfo vertexSpecializationInfo
+    {
+        .mapEntryCount = 1,
+        .pMapEntries = &octahedralNormalsEntry,
+        .dataSize = sizeof(VkBool32),
+        .pData = &octahedralNormals
+    };
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {
         vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertexModule.value()),
         vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragmentModule.value())
     };
+    shaderStages[0].pSpecializationInfo = &vertexSpecializationInfo;
     const VertexInputDescription vertexInputDescription = vertexMesh->getDescription();
     const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo
     {
@@ -985,9 +1378,77 @@ void Engine::initDescriptors()
 
 void Engine::initSamplers()
 {
-    VkSamplerCreateInfo samplerInfo = vkinit::samplerCreateInfo(VK_FILTER_NEAREST);
-    VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &blockySampler));
-    QUEUE_DESTROY(vkDestroySampler(device, blockySampler, nullptr));
+    samplerCache.reset(new vkut::SamplerCache(device));
+    QUEUE_DESTROY(delete samplerCache.get(); samplerCache.release());
+}
+
+void Engine::initCulling()
+{
+    QUEUE_DESTROY_REF(destroyGPUDrivenScene());
+
+    if (!drawIndirectCountSupported)
+    {
+        Logger::logWarning("drawIndirectCount isn't supported, objects will be culled on the cpu");
+        return;
+    }
+
+    //objects, batches, object batches, command groups, commands, visible objects, compacted commands and draw counts
+    std::array<VkDescriptorSetLayoutBinding, 8> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i] = VkDescriptorSetLayoutBinding
+        {
+            .binding = i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+        };
+    }
+
+    const VkDescriptorSetLayoutCreateInfo setLayoutInfo
+    {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data(),
+    };
+    cullSetLayout = descriptorLayoutCache->getLayout(setLayoutInfo);
+
+    const VkPushConstantRange parametersRange
+    {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(GPUCullParameters)
+    };
+    cullPipelineLayout = vkut::createPipelineLayout(device, { cullSetLayout }, { parametersRange });
+    QUEUE_DESTROY(vkut::destroyPipelineLayout(device, cullPipelineLayout));
+
+    const std::string shaderPath = getShaderPath("cull.comp.spv");
+    const std::optional<VkShaderModule> cullModule = vkut::createShaderModule(device, shaderPath.c_str());
+    if (!cullModule.has_value())
+    {
+        Logger::logErrorFormatted("Failed to load %s, objects will be culled on the cpu", shaderPath.c_str());
+        return;
+    }
+
+    const VkComputePipelineCreateInfo pipelineInfo
+    {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, cullModule.value()),
+        .layout = cullPipelineLayout
+    };
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &cullPipeline));
+    vkut::destroyShaderModule(device, cullModule.value());
+    QUEUE_DESTROY(vkDestroyPipeline(device, cullPipeline, nullptr));
+
+    //the sets live as long as the allocator, every rebuild only rewrites what they point at
+    for (FrameData &frame : frames)
+    {
+        const std::optional<VkDescriptorSet> cullSet = descriptorAllocator->allocate(cullSetLayout);
+        const std::optional<VkDescriptorSet> visibleObjectsSet = descriptorAllocator->allocate(objectsSetLayout);
+        assert(cullSet.has_value() && visibleObjectsSet.has_value());
+        frame.cullDescriptor = cullSet.value();
+        frame.visibleObjectsDescriptor = visibleObjectsSet.value();
+    }
 }
 
 void Engine::onWindowResize()
@@ -1021,45 +1482,96 @@ void Engine::onWindowResize()
 MeshHandle Engine::loadMesh(const char *name)
 {
     const std::string path = getModelPath(name);
-    const auto loadResult = Mesh::load(path.c_str());
-    if (!loadResult.has_value())
+    const std::optional<OFile::Mapped> file = OFile::map(path.c_str());
+    if (!file.has_value())
     {
         Logger::logErrorFormatted("Failed to load mesh at path \"%s\"!", path.c_str());
         return MeshHandle::invalidHandle();
     }
 
-    const MeshHandle handle = MeshHandle::getNextHandle();
+    //the CPU side only keeps the header, the vertices and indices only ever exist in the staging buffer
+    Mesh mesh{ .data = OFile(file->header()) };
+    if (!uploadMesh(mesh, file.value()))
+    {
+        Logger::logErrorFormatted("Failed to decompress mesh at path \"%s\"!", path.c_str());
+        return MeshHandle::invalidHandle();
+    }
 
-    meshes.add(handle, loadResult.value());
-    uploadMesh(*meshes.get(handle));
+    const MeshHandle handle = MeshHandle::getNextHandle();
+    meshes.add(handle, mesh);
     Logger::logMessageFormatted("Successfully loaded mesh at path \"%s\"!", path.c_str());
     return handle;
 }
 
 TextureHandle Engine::loadTexture(const char *name)
 {
-    const std::string path = getTexturePath(name);
+    return loadTextures(std::span(&name, 1)).front();
+}
+
+std::vector<TextureHandle> Engine::loadTextures(std::span<const char *const> names)
+{
     const vkut::ImageLoadContext loadContext
     {
+        .physicalDevice = physicalDevice,
         .device = device,
         .allocator = allocator,
         .uploadFence = uploadFence,
         .uploadCommandPool = uploadCommandPool,
         .queue = graphicsQueue
     };
-    const std::optional<AllocatedImage> image = vkut::loadImageFromFile(loadContext, path.c_str());
+
+    std::vector<TextureHandle> handles(names.size(), TextureHandle::invalidHandle());
+    std::vector<std::string> imagePaths;
+    std::vector<size_t> imageIndices;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        const std::string path = getTexturePath(names[i]);
+        //.tex files come out of the asset compiler with their mips and block compression done, anything else goes through stb_image
+        if (path.ends_with(".tex"))
+        {
+            handles[i] = addTexture(vkut::loadTextureFile(loadContext, path.c_str(), &threadPool), path);
+        }
+        else
+        {
+            imagePaths.push_back(path);
+            imageIndices.push_back(i);
+        }
+    }
+
+    //the images are all decoded in parallel and uploaded together rather than waiting on the gpu once per image
+    std::vector<const char *> imagePathPointers;
+    for (const std::string &path : imagePaths) imagePathPointers.push_back(path.c_str());
+    const std::vector<std::optional<vkut::LoadedImage>> images = vkut::loadImagesFromFiles(loadContext, imagePathPointers, &threadPool);
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        handles[imageIndices[i]] = addTexture(images[i], imagePaths[i]);
+    }
+    return handles;
+}
+
+TextureHandle Engine::addTexture(const std::optional<vkut::LoadedImage> &image, const std::string &path)
+{
     if(!image.has_value())
     {
         Logger::logErrorFormatted("Failed to load texture at path \"%s\"!", path.c_str());
         return TextureHandle::invalidHandle();
     }
     
-    VkImageView view = vkut::createImageView(device, image.value().image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-    QUEUE_DESTROY(vkmem::destroyImage(allocator, image.value()));
+    VkImageView view = vkut::createImageView(device, image.value().image.image, image.value().format, VK_IMAGE_ASPECT_COLOR_BIT, image.value().mipLevels);
+    QUEUE_DESTROY(vkmem::destroyImage(allocator, image.value().image));
     QUEUE_DESTROY(vkut::destroyImageView(device, view));
 
+    //magnified texels stay blocky, minified ones are blended across the mip chain with as much anisotropy as the device allows
+    VkSamplerCreateInfo samplerInfo = vkinit::samplerCreateInfo(VK_FILTER_NEAREST);
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.anisotropyEnable = VK_TRUE;
+    samplerInfo.maxAnisotropy = physicalDeviceProperties.limits.maxSamplerAnisotropy;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE; //not the texture's level count, so every texture can share the sampler
+    const VkSampler sampler = samplerCache->getSampler(samplerInfo);
+
     TextureHandle handle = TextureHandle::getNextHandle();
-    textures.add(handle, image.value(), view);
+    textures.add(handle, image.value().image, view, sampler);
     Logger::logMessageFormatted("Successfully loaded texture at path \"%s\"!", path.c_str());
     return handle;
 }
@@ -1078,14 +1590,53 @@ void Engine::addRenderObject(MeshHandle meshHandle, MaterialHandle materialHandl
         return;
     }
 
-    const RenderObject object = 
+    //one object per submesh, so each picks its own level of detail, the LOD indices after the submeshes are never drawn whole
+    for (uint32_t submesh = 0; submesh < mesh->data.submeshes().size(); submesh++)
+    {
+        insertRenderObject(RenderObject
+        {
+            .mesh = mesh,
+            .material = material,
+            .transform = transform,
+            .color = color,
+            .submesh = submesh
+        });
+    }
+}
+
+void Engine::addRenderObject(MeshHandle meshHandle, uint32_t submeshIndex, MaterialHandle materialHandle, mat4x4 transform, vec4 color)
+{
+    Mesh *mesh = getMesh(meshHandle);
+    if(mesh == nullptr)
+    {
+        return;
+    }
+
+    const std::vector<OFile::Submesh> &submeshes = mesh->data.submeshes();
+    if(submeshIndex >= submeshes.size())
+    {
+        Logger::logErrorFormatted("Submesh %u is out of range, the mesh only has %u", submeshIndex, static_cast<uint32_t>(submeshes.size()));
+        return;
+    }
+
+    Material *material = getMaterial(materialHandle);
+    if(material == nullptr)
+    {
+        return;
+    }
+
+    insertRenderObject(RenderObject
     {
         .mesh = mesh,
         .material = material,
         .transform = transform,
-        .color = color
-    };
+        .color = color,
+        .submesh = submeshIndex
+    });
+}
 
+void Engine::insertRenderObject(const RenderObject &object)
+{
     //sorting by pipeline and then by mesh
     auto pipelineLowerBound = std::lower_bound(renderables.begin(), renderables.end(), object.material->pipeline, [](const RenderObject &ob, VkPipeline pipeline) { return ob.material->pipeline < pipeline; });
     auto meshStart = std::find_if(pipelineLowerBound, renderables.end(), [&object](const RenderObject& ob)
@@ -1100,6 +1651,176 @@ void Engine::addRenderObject(MeshHandle meshHandle, MaterialHandle materialHandl
     {
         renderables.insert(pipelineLowerBound, object);
     }
+    gpuDrivenScene.dirty = true;
+}
+
+void Engine::rebuildGPUDrivenScene()
+{
+    //the frames in flight could still be reading the old buffers and the sets pointing at them
+    std::array<VkFence, overlappingFrameNumber> frameFences;
+    for (size_t i = 0; i < frames.size(); i++) frameFences[i] = frames[i].renderFence;
+    VK_CHECK(vkWaitForFences(device, static_cast<uint32_t>(frameFences.size()), frameFences.data(), true, UINT64_MAX));
+
+    destroyGPUDrivenScene();
+    gpuDrivenScene.dirty = false;
+    if (renderables.empty()) return;
+
+    //every object drawing the same submesh with the same material next to each other, and every batch drawing the same mesh with the same material after that
+    std::vector<const RenderObject *> objects;
+    objects.reserve(renderables.size());
+    for (const RenderObject &object : renderables) objects.push_back(&object);
+    std::stable_sort(objects.begin(), objects.end(), [](const RenderObject *a, const RenderObject *b)
+    {
+        return std::make_tuple(std::uintptr_t(a->material->pipeline), std::uintptr_t(a->material), std::uintptr_t(a->mesh), a->submesh)
+            < std::make_tuple(std::uintptr_t(b->material->pipeline), std::uintptr_t(b->material), std::uintptr_t(b->mesh), b->submesh);
+    });
+
+    std::vector<GPUObjectData> objectData;
+    std::vector<uint32_t> objectBatches;
+    std::vector<GPUCullBatch> batches;
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+    std::vector<std::array<uint32_t, 2>> commandGroups;
+    objectData.reserve(objects.size());
+    objectBatches.reserve(objects.size());
+
+    uint32_t visibleObjectCount = 0;
+    for (size_t batchStart = 0; batchStart < objects.size();)
+    {
+        const RenderObject &first = *objects[batchStart];
+        size_t batchEnd = batchStart + 1;
+        while (batchEnd < objects.size() && objects[batchEnd]->material == first.material && objects[batchEnd]->mesh == first.mesh && objects[batchEnd]->submesh == first.submesh) batchEnd++;
+
+        const bool newGroup = gpuDrivenScene.groups.empty() || gpuDrivenScene.groups.back().material != first.material || gpuDrivenScene.groups.back().mesh != first.mesh;
+        if (newGroup)
+        {
+            gpuDrivenScene.groups.push_back({ .material = first.material, .mesh = first.mesh, .firstCommand = static_cast<uint32_t>(commands.size()), .maxCommands = 0 });
+        }
+        IndirectDrawGroup &group = gpuDrivenScene.groups.back();
+
+        const OFile &data = first.mesh->data;
+        const OFile::Submesh &submesh = data.submeshes()[first.submesh];
+        const uint32_t lodCount = std::min<uint32_t>(submesh.lodCount, 8); //the most GPUCullBatch has room for, the rest are never picked
+        const bool quantised = data.hasQuantisedPositions();
+        const vec3 positionOffset = quantised ? data.header().positionOffset : vec3{ .0f, .0f, .0f };
+        const vec3 positionScale = quantised ? data.header().positionScale : vec3{ 1.0f, 1.0f, 1.0f };
+
+        GPUCullBatch batch
+        {
+            .sphere = vec4(submesh.bounds.center.x(), submesh.bounds.center.y(), submesh.bounds.center.z(), submesh.bounds.radius),
+            .positionOffset = vec4(positionOffset.x(), positionOffset.y(), positionOffset.z(), .0f),
+            .positionScale = vec4(positionScale.x(), positionScale.y(), positionScale.z(), .0f),
+            .firstCommand = static_cast<uint32_t>(commands.size()),
+            .lodCount = lodCount
+        };
+
+        //each level gets room for every object in the batch, since the cull pass could pick it for all of them
+        const uint32_t instanceCount = static_cast<uint32_t>(batchEnd - batchStart);
+        for (uint32_t level = 0; level <= lodCount; level++)
+        {
+            const bool fullDetail = level == 0;
+            const OFile::Lod *lod = fullDetail ? nullptr : &data.lods()[submesh.firstLod + level - 1];
+            if (lod != nullptr) batch.lodErrors[level - 1] = lod->error;
+
+            commandGroups.push_back({ static_cast<uint32_t>(gpuDrivenScene.groups.size() - 1), group.firstCommand });
+            commands.push_back(VkDrawIndexedIndirectCommand
+            {
+                .indexCount = fullDetail ? submesh.indexCount : lod->indexCount,
+                .instanceCount = 0,
+                .firstIndex = fullDetail ? submesh.firstIndex : lod->firstIndex,
+                .vertexOffset = 0,
+                .firstInstance = visibleObjectCount
+            });
+            visibleObjectCount += instanceCount;
+            group.maxCommands++;
+        }
+
+        for (size_t i = batchStart; i < batchEnd; i++)
+        {
+            objectData.push_back({ .modelMatrix = objects[i]->transform, .color = objects[i]->color });
+            objectBatches.push_back(static_cast<uint32_t>(batches.size()));
+        }
+        batches.push_back(batch);
+        batchStart = batchEnd;
+    }
+
+    gpuDrivenScene.objectCount = static_cast<uint32_t>(objectData.size());
+    gpuDrivenScene.commandCount = static_cast<uint32_t>(commands.size());
+    gpuDrivenScene.visibleObjectCapacity = visibleObjectCount;
+
+    const auto createStaticBuffer = [&]<typename T>(const std::vector<T> &contents, VkBufferUsageFlags usage)
+    {
+        const size_t size = sizeof(T) * contents.size();
+        const AllocatedBuffer buffer = vkmem::createBuffer(size, usage, allocator, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        vkmem::uploadToBuffer<T>({ .data = contents.data(), .buffer = buffer, .size = size });
+        return buffer;
+    };
+    gpuDrivenScene.objectsBuffer = createStaticBuffer(objectData, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    gpuDrivenScene.objectBatchesBuffer = createStaticBuffer(objectBatches, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    gpuDrivenScene.batchesBuffer = createStaticBuffer(batches, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    gpuDrivenScene.commandGroupsBuffer = createStaticBuffer(commandGroups, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    gpuDrivenScene.commandTemplateBuffer = createStaticBuffer(commands, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+    const size_t commandsSize = sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+    const size_t visibleObjectsSize = sizeof(GPUObjectData) * visibleObjectCount;
+    const size_t drawCountsSize = sizeof(uint32_t) * gpuDrivenScene.groups.size();
+    for (FrameData &frame : frames)
+    {
+        frame.drawCommandsBuffer = vkmem::createBuffer(commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, allocator, VMA_MEMORY_USAGE_GPU_ONLY);
+        frame.visibleObjectsBuffer = vkmem::createBuffer(visibleObjectsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, allocator, VMA_MEMORY_USAGE_GPU_ONLY);
+        frame.compactedCommandsBuffer = vkmem::createBuffer(commandsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, allocator, VMA_MEMORY_USAGE_GPU_ONLY);
+        frame.drawCountsBuffer = vkmem::createBuffer(drawCountsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, allocator, VMA_MEMORY_USAGE_GPU_ONLY);
+
+        const std::array<VkDescriptorBufferInfo, 8> cullBuffers
+        {
+            VkDescriptorBufferInfo{ .buffer = gpuDrivenScene.objectsBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+            VkDescriptorBufferInfo{ .buffer = gpuDrivenScene.batchesBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+            VkDescriptorBufferInfo{ .buffer = gpuDrivenScene.objectBatchesBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+            VkDescriptorBufferInfo{ .buffer = gpuDrivenScene.commandGroupsBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+            VkDescriptorBufferInfo{ .buffer = frame.drawCommandsBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+            VkDescriptorBufferInfo{ .buffer = frame.visibleObjectsBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+            VkDescriptorBufferInfo{ .buffer = frame.compactedCommandsBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+            VkDescriptorBufferInfo{ .buffer = frame.drawCountsBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+        };
+        const auto storageWrite = [](VkDescriptorSet set, uint32_t binding, const VkDescriptorBufferInfo &info)
+        {
+            return VkWriteDescriptorSet
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = set,
+                .dstBinding = binding,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo = &info
+            };
+        };
+
+        std::array<VkWriteDescriptorSet, 9> writes; //every cull binding, then the visible objects on their own
+        for (uint32_t binding = 0; binding < cullBuffers.size(); binding++) writes[binding] = storageWrite(frame.cullDescriptor, binding, cullBuffers[binding]);
+        writes.back() = storageWrite(frame.visibleObjectsDescriptor, 0, cullBuffers[5]);
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+}
+
+void Engine::destroyGPUDrivenScene()
+{
+    //vma ignores null buffers, so this is fine before the first rebuild too
+    vkmem::destroyBuffer(allocator, gpuDrivenScene.objectsBuffer);
+    vkmem::destroyBuffer(allocator, gpuDrivenScene.objectBatchesBuffer);
+    vkmem::destroyBuffer(allocator, gpuDrivenScene.batchesBuffer);
+    vkmem::destroyBuffer(allocator, gpuDrivenScene.commandGroupsBuffer);
+    vkmem::destroyBuffer(allocator, gpuDrivenScene.commandTemplateBuffer);
+    for (FrameData &frame : frames)
+    {
+        vkmem::destroyBuffer(allocator, frame.drawCommandsBuffer);
+        vkmem::destroyBuffer(allocator, frame.visibleObjectsBuffer);
+        vkmem::destroyBuffer(allocator, frame.compactedCommandsBuffer);
+        vkmem::destroyBuffer(allocator, frame.drawCountsBuffer);
+        frame.drawCommandsBuffer = {};
+        frame.visibleObjectsBuffer = {};
+        frame.compactedCommandsBuffer = {};
+        frame.drawCountsBuffer = {};
+    }
+    gpuDrivenScene = GPUDrivenScene{};
 }
 
 vkut::UploadContext Engine::getUploadContext() const
@@ -1113,62 +1834,51 @@ vkut::UploadContext Engine::getUploadContext() const
     };
 }
 
-void Engine::uploadMesh(Mesh &mesh)
+bool Engine::uploadMesh(Mesh &mesh, const OFile::Mapped &file)
 {
     const VmaMemoryUsage vmaStagingBufferUsage = VMA_MEMORY_USAGE_CPU_ONLY; //on CPU RAM
     const VmaMemoryUsage vmaBuffersUsage = VMA_MEMORY_USAGE_GPU_ONLY;
-    
-    const vkut::UploadContext uploadContext = getUploadContext();
 
-    //vertex buffer
+    const OFile::Header &header = file.header();
+    const size_t vertexBufferSize = header.vertexBytes();
+    const size_t indexBufferSize = header.indexBytes();
+
+    //the payload is laid out as vertices then indices, so one staging buffer holds both
+    AllocatedBuffer stagingBuffer = vkmem::createBuffer(header.payloadBytes(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, allocator, vmaStagingBufferUsage);
+    if (!file.decompressPayload(static_cast<std::byte *>(vkmem::getMappedData(stagingBuffer)), &threadPool))
     {
-        const uint32_t vertexBufferSize = static_cast<uint32_t>(mesh.data.vertexAmount() * mesh.data.vertexSize());
+        vkmem::destroyBuffer(allocator, stagingBuffer);
+        return false;
+    }
 
-        AllocatedBuffer vertexStagingBuffer = vkmem::createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, allocator, vmaStagingBufferUsage);
-        memcpy(vkmem::getMappedData(vertexStagingBuffer), mesh.data.vertices().data(), vertexBufferSize);
+    const VkBufferUsageFlags vkVertexBufferUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    mesh.vertexBuffer = vkmem::createBuffer(vertexBufferSize, vkVertexBufferUsage, allocator, vmaBuffersUsage);
+    QUEUE_DESTROY(vkmem::destroyBuffer(allocator, mesh.vertexBuffer));
 
-        const VkBufferUsageFlags vkVertexBufferUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-        mesh.vertexBuffer = vkmem::createBuffer(vertexBufferSize, vkVertexBufferUsage, allocator, vmaBuffersUsage);
-        QUEUE_DESTROY(vkmem::destroyBuffer(allocator, mesh.vertexBuffer));
+    const VkBufferUsageFlags vkIndexBufferUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    mesh.indexBuffer = vkmem::createBuffer(indexBufferSize, vkIndexBufferUsage, allocator, vmaBuffersUsage);
+    QUEUE_DESTROY(vkmem::destroyBuffer(allocator, mesh.indexBuffer));
 
-        vkut::submitCommand(uploadContext,
-            [=](VkCommandBuffer cmd) 
+    vkut::submitCommand(getUploadContext(),
+        [=](VkCommandBuffer cmd)
+        {
+            const VkBufferCopy vertexCopy
             {
-                const VkBufferCopy copy
-                {
-                    .srcOffset = 0,
-                    .dstOffset = 0,
-                    .size = vertexBufferSize,
-                };
-                vkCmdCopyBuffer(cmd, vertexStagingBuffer.buffer, mesh.vertexBuffer.buffer, 1, &copy);
-            });
-
-        vkmem::destroyBuffer(allocator, vertexStagingBuffer);
-    }
-    
-    //index buffer
-    {
-        const uint32_t indexBufferSize = static_cast<uint32_t>(mesh.data.indices().size() * sizeof(mesh.data.indices()[0]));
-        
-        AllocatedBuffer indexStagingBuffer = vkmem::createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, allocator, vmaStagingBufferUsage);
-        memcpy(vkmem::getMappedData(indexStagingBuffer), mesh.data.indices().data(), indexBufferSize);
-
-        const VkBufferUsageFlags vkIndexBufferUsage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-        mesh.indexBuffer = vkmem::createBuffer(indexBufferSize, vkIndexBufferUsage, allocator, vmaBuffersUsage);
-        QUEUE_DESTROY(vkmem::destroyBuffer(allocator, mesh.indexBuffer));
+                .srcOffset = 0,
+                .dstOffset = 0,
+                .size = vertexBufferSize,
+            };
+            vkCmdCopyBuffer(cmd, stagingBuffer.buffer, mesh.vertexBuffer.buffer, 1, &vertexCopy);
 
-        vkut::submitCommand(uploadContext,
-            [=](VkCommandBuffer cmd)
+            const VkBufferCopy indexCopy
             {
-                const VkBufferCopy copy
-                {
-                    .srcOffset = 0,
-                    .dstOffset = 0,
-                    .size = indexBufferSize,
-                };
-                vkCmdCopyBuffer(cmd, indexStagingBuffer.buffer, mesh.indexBuffer.buffer, 1, &copy);
-            });
+                .srcOffset = vertexBufferSize,
+                .dstOffset = 0,
+                .size = indexBufferSize,
+            };
+            vkCmdCopyBuffer(cmd, stagingBuffer.buffer, mesh.indexBuffer.buffer, 1, &indexCopy);
+        });
 
-        vkmem::destroyBuffer(allocator, indexStagingBuffer);
-    }
+    vkmem::destroyBuffer(allocator, stagingBuffer);
+    return true;
 }
@@ -10,12 +10,19 @@
 #include <ResourceMap.h>
 #include <ConsoleVariables.h>
 #include <DescriptorSetBuilder.h>
+#include <SamplerCache.h>
+#include <Image.h>
+#include <ThreadPool.h>
+#include <FrustumCulling.h>
 
 #include <deque>
 #include <functional>
 #include <unordered_map>
 #include <array>
 #include <vector>
+#include <span>
+#include <optional>
+#include <string>
 
 class Camera;
 class Window;
@@ -54,6 +61,7 @@ struct RenderObject
 	Material* material;
 	mat4x4 transform;
 	vec4 color;
+	uint32_t submesh; //which of the mesh's submeshes is drawn, its level of detail is picked every frame
 };
 
 struct SwapchainInfo
@@ -87,6 +95,62 @@ struct GPUObjectData
 	vec4 color;
 };
 
+//std430 mirror of cull.comp's CullBatch: a submesh drawn with one material, with a draw command for each of its levels of detail
+struct GPUCullBatch
+{
+	vec4 sphere; //model space center and radius
+	vec4 positionOffset;
+	vec4 positionScale;
+	uint32_t firstCommand; //full detail, followed by each level of detail
+	uint32_t lodCount;
+	uint32_t padding[2];
+	std::array<float, 8> lodErrors;
+};
+static_assert(sizeof(GPUCullBatch) == 96, "has to match the std430 layout of CullBatch in cull.comp");
+
+//cull.comp's push constants, which have to fit in the 128 bytes every device offers
+struct GPUCullParameters
+{
+	FrustumPlanes frustumPlanes;
+	vec4 eye; //w is the near plane's distance
+	float lodThreshold;
+	uint32_t objectCount;
+	uint32_t commandCount;
+	uint32_t phase;
+};
+static_assert(sizeof(GPUCullParameters) == 128, "has to fit the guaranteed push constant size");
+
+//one vkCmdDrawIndexedIndirectCount over the compacted commands of every submesh drawn with a material and mesh
+struct IndirectDrawGroup
+{
+	Material *material;
+	Mesh *mesh;
+	uint32_t firstCommand;
+	uint32_t maxCommands;
+};
+
+//what the cull pass reads, which only changes when objects are added
+struct GPUDrivenScene
+{
+	AllocatedBuffer objectsBuffer; //GPUObjectData with the objects' own transforms, in batch order
+	AllocatedBuffer objectBatchesBuffer; //which batch each object belongs to
+	AllocatedBuffer batchesBuffer;
+	AllocatedBuffer commandGroupsBuffer; //per command, its draw group and where that group's compacted commands start
+	AllocatedBuffer commandTemplateBuffer; //every command with no instances, copied over the frame's commands before culling
+	std::vector<IndirectDrawGroup> groups;
+	uint32_t objectCount = 0;
+	uint32_t commandCount = 0;
+	uint32_t visibleObjectCapacity = 0; //every object could end up at any of its levels, so each level's command gets room for all of them
+	bool dirty = true;
+};
+
+//a secondary command buffer with a pool of its own, so it can be recorded on one thread while others record theirs
+struct SecondaryCommands
+{
+	VkCommandPool pool;
+	VkCommandBuffer buffer;
+};
+
 struct FrameData 
 {
 	VkSemaphore presentSemaphore;
@@ -95,9 +159,20 @@ struct FrameData
 
 	VkCommandPool commandPool;
 	VkCommandBuffer mainCommandBuffer;
+	std::vector<SecondaryCommands> objectCommands; //one for each thread drawObjects records on
+	SecondaryCommands uiCommands;
 
 	AllocatedBuffer objectsBuffer;
 	VkDescriptorSet objectsDescriptor;
+
+	//written by the cull pass every frame, null until the first rebuildGPUDrivenScene
+	AllocatedBuffer drawCommandsBuffer{};
+	AllocatedBuffer visibleObjectsBuffer{};
+	AllocatedBuffer compactedCommandsBuffer{};
+	AllocatedBuffer drawCountsBuffer{};
+	//allocated once by initCulling, rebuildGPUDrivenScene points them at the new buffers
+	VkDescriptorSet cullDescriptor{};
+	VkDescriptorSet visibleObjectsDescriptor{}; //takes objectsDescriptor's place in the indirect draws
 };
 
 constexpr uint32_t overlappingFrameNumber = 2;
@@ -114,6 +189,10 @@ public:
 	MeshHandle loadMesh(const char *name);
 	[[nodiscard]]
 	TextureHandle loadTexture(const char *name);
+	//loads the textures in one go, the images among them are decoded in parallel and share their staging buffers and submissions
+	//the handles line up with names, with invalid ones for textures that couldn't be loaded
+	[[nodiscard]]
+	std::vector<TextureHandle> loadTextures(std::span<const char *const> names);
 
 	[[nodiscard]]
 	Material* getMaterial(MaterialHandle handle);
@@ -121,6 +200,8 @@ public:
 	Mesh *getMesh(MeshHandle handle);
 	
 	void addRenderObject(MeshHandle mesh, MaterialHandle material, mat4x4 transform, vec4 color);
+	//draws only the given submesh of the mesh, so each one can have its own material
+	void addRenderObject(MeshHandle mesh, uint32_t submeshIndex, MaterialHandle material, mat4x4 transform, vec4 color);
 	
 	void getNextImage(VkSemaphore waitSemaphore);
 	void startRecording(VkCommandBuffer cmd, VkFence waitFence);
@@ -128,7 +209,13 @@ public:
 	void drawToScreen(Time deltaTime, const Camera& camera);
 	void present(VkSemaphore waitSemaphore);
 	void drawToBuffer(Time deltaTime, const Camera& camera, std::byte* data, size_t count);
+	//records the draws across the thread pool into secondary command buffers and executes them in cmd
+	//so cmd has to be in a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
 	void drawObjects(VkCommandBuffer cmd, RenderObject *first, size_t count, const Camera& camera);
+	//culls the renderables against the camera's frustum and picks their levels of detail on the gpu, has to be recorded outside the render pass
+	void cullObjects(VkCommandBuffer cmd, const Camera &camera);
+	//draws what cullObjects left visible, with one indirect draw per material and mesh however many objects there are
+	void drawObjectsIndirect(VkCommandBuffer cmd);
 
 	Engine(Window& window);
 	~Engine();
@@ -142,14 +229,18 @@ private:
 	void initVulkan();
 	void initImgui();
 	void initCommands();
+	[[nodiscard]]
+	SecondaryCommands createSecondaryCommands();
 	void initDefaultRenderpass();
 	void initFramebuffers(bool recreating = false);
 	void initSyncPrimitives();
 	void initDepthResources(bool recreating = false);
 	void initDescriptors();
 	void initSamplers();
+	void initCulling();
 
 	void onWindowResize();
+	void insertRenderObject(const RenderObject &object);
 
 	bool initialized = false;
 	size_t frameCount{};
@@ -196,19 +287,50 @@ private:
 
 	DeletionQueue mainDeletionQueue{};
 
+	//for splitting up loading and recording work, e.g. decompressing the chunks of a mesh or recording drawObjects into secondaries
+	ThreadPool threadPool{};
+
 	std::vector<RenderObject> renderables;
+	//drawObjects' frustum culling, kept around so it doesn't allocate every frame
+	SphereBatch cullingSpheres;
+	std::vector<uint32_t> visibleRenderables;
 	ResourceMap<MaterialHandle, Material> materials;
 	ResourceMap<MeshHandle, Mesh> meshes;
 	ResourceMap<TextureHandle, Texture> textures;
-	//todo: make this an unordered map of samplers, create as they're asked
-	VkSampler blockySampler;
+	std::unique_ptr<vkut::SamplerCache> samplerCache;
+
+	//null when the device can't draw indirect with a count or cull.comp couldn't be loaded, everything is then drawn by drawObjects
+	VkPipeline cullPipeline{};
+	VkPipelineLayout cullPipelineLayout{};
+	VkDescriptorSetLayout cullSetLayout{};
+	bool drawIndirectCountSupported = false;
+	GPUDrivenScene gpuDrivenScene{};
+
+	[[nodiscard]]
+	bool useGPUDrivenRendering() const;
+	//rebuilds the cull pass' inputs and the frames' outputs from the renderables, waiting for every frame in flight first
+	//has to be called before the current frame starts recording
+	void rebuildGPUDrivenScene();
+	void destroyGPUDrivenScene();
+	//returns what it uploaded, so the frustum can be culled against the same viewProjection the shaders use
+	GPUCameraData uploadCameraData(const Camera &camera);
+	void bindMaterial(VkCommandBuffer cmd, const Material &material, VkDescriptorSet objectsDescriptor);
+	void bindMesh(VkCommandBuffer cmd, const Mesh &mesh);
+	//resets the pool and begins the buffer to continue the render pass into the current framebuffer, with the viewport and scissor set
+	VkCommandBuffer beginSecondary(const SecondaryCommands &commands);
 
 	vkut::UploadContext getUploadContext() const;
 
+	//makes a view and picks a sampler for a loaded image, logging whether it loaded
+	[[nodiscard]]
+	TextureHandle addTexture(const std::optional<vkut::LoadedImage> &image, const std::string &path);
+
 	VmaAllocator allocator{};
 
 	VkFence uploadFence;
 	VkCommandPool uploadCommandPool;
 
-	void uploadMesh(Mesh &mesh);
+	//decompresses the mapped file straight into a staging buffer and copies it to the mesh's buffers
+	[[nodiscard]]
+	bool uploadMesh(Mesh &mesh, const OFile::Mapped &file);
 };
\ No newline at end of file
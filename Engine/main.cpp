@@ -15,7 +15,7 @@
 
 constexpr const char *vertexShaderPath = "shader.vert.spv";
 constexpr const char *fragmentShaderPath = "shader.frag.spv";
-constexpr const char *texturePath = "minecraft.png";
+constexpr const char *texturePath = "minecraft.tex";
 constexpr const char *meshPath = "minecraft.o";
 
 Camera camera;
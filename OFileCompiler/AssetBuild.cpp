@@ -0,0 +1,342 @@
+#include "AssetBuild.h"
+#include "AssetCache.h"
+#include "ThreadPool.h"
+#include "Logger/Logger.h"
+#include "Serializer.h"
+#include <lz4/xxhash.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	std::string normalizedPath(const fs::path &path)
+	{
+		return path.lexically_normal().generic_string();
+	}
+
+	bool isShaderSource(const fs::path &path)
+	{
+		const fs::path extension = path.extension();
+		return extension == ".vert" || extension == ".frag" || extension == ".comp";
+	}
+
+	//every file pulled in through #include "...", recursively, relative to the including file
+	void gatherIncludes(const fs::path &path, std::unordered_set<std::string> &visited, std::vector<std::string> &includes)
+	{
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			const size_t directive = line.find("#include");
+			if (directive == std::string::npos || line.find_first_not_of(" \t") != directive) continue;
+
+			const size_t open = line.find('"', directive);
+			const size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+			if (close == std::string::npos) continue;
+
+			const fs::path included = path.parent_path() / line.substr(open + 1, close - open - 1);
+			if (!visited.insert(normalizedPath(included)).second) continue;
+
+			includes.push_back(normalizedPath(included));
+			gatherIncludes(included, visited, includes);
+		}
+	}
+
+	//the words after a keyword at the start of a line, or an empty view if the line starts with something else
+	std::string_view afterKeyword(std::string_view line, std::string_view keyword)
+	{
+		const size_t start = line.find_first_not_of(" \t");
+		if (start == std::string_view::npos || line.substr(start, keyword.size()) != keyword) return {};
+
+		line.remove_prefix(start + keyword.size());
+		if (line.empty() || (line.front() != ' ' && line.front() != '\t')) return {};
+		const size_t first = line.find_first_not_of(" \t");
+		const size_t last = line.find_last_not_of(" \t\r");
+		return first == std::string_view::npos ? std::string_view{} : line.substr(first, last - first + 1);
+	}
+
+	//the .mtl files an .obj's mtllib lines name, relative to the .obj, they decide its material slots
+	void gatherMaterialLibraries(const fs::path &path, std::vector<std::string> &libraries)
+	{
+		std::unordered_set<std::string> visited;
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::string_view names = afterKeyword(line, "mtllib");
+			while (!names.empty())
+			{
+				const size_t end = names.find_first_of(" \t");
+				const fs::path library = path.parent_path() / std::string(names.substr(0, end));
+				names = end == std::string_view::npos ? std::string_view{} : names.substr(names.find_first_not_of(" \t", end));
+				if (visited.insert(normalizedPath(library)).second) libraries.push_back(normalizedPath(library));
+			}
+		}
+	}
+
+	//what goes into a shader besides its source: the compiler and the current contents of everything it includes
+	uint64_t shaderSettingsHash(const BuildNode &node, const BuildTools &tools)
+	{
+		StretchyStreamOut settings;
+		settings.setNext(tools.glslangValidator.data(), tools.glslangValidator.size());
+		for (const std::string &input : node.inputs)
+		{
+			settings.setNext(AssetCache::hashFile(input));
+		}
+		return XXH64(settings.getData(), settings.bytesWritten(), 0);
+	}
+
+	std::string quoted(const std::string &string)
+	{
+		return "\"" + string + "\"";
+	}
+
+	CompileResult compileShader(const BuildNode &node, const BuildTools &tools)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		CompileResult result
+		{
+			.sourcePath = node.sourcePath,
+			.destinationPath = node.outputPath
+		};
+
+		std::error_code error;
+		const fs::path destinationDirectory = fs::path(node.outputPath).parent_path();
+		if (!destinationDirectory.empty()) fs::create_directories(destinationDirectory, error);
+
+		std::string command = quoted(tools.glslangValidator) + " -V " + quoted(node.sourcePath) + " -o " + quoted(node.outputPath);
+#ifdef _WIN32
+		command = quoted(command); //cmd strips the outermost quotes, which would otherwise be the executable's
+#endif
+		result.succeeded = std::system(command.c_str()) == 0;
+		if (!result.succeeded) Logger::logErrorFormatted("Could not compile shader %s", node.sourcePath.c_str());
+
+		result.sourceBytes = fs::file_size(node.sourcePath, error);
+		result.outputBytes = result.succeeded ? fs::file_size(node.outputPath, error) : 0;
+		result.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	}
+
+	CompileResult buildNode(const BuildNode &node, const CompileOptions &options, const BuildTools &tools, AssetCache &cache, ThreadPool &pool)
+	{
+		if (node.kind != BuildNode::Kind::shader)
+		{
+			return compileAssetCached(node.sourcePath, node.outputPath, options, cache, &pool, node.inputs);
+		}
+
+		const uint64_t settingsHash = shaderSettingsHash(node, tools);
+		if (cache.isUpToDate(node.sourcePath, node.outputPath, settingsHash))
+		{
+			return CompileResult{ .sourcePath = node.sourcePath, .destinationPath = node.outputPath, .succeeded = true, .upToDate = true };
+		}
+
+		const std::optional<AssetCache::SourceStamp> source = AssetCache::stampSource(node.sourcePath);
+		CompileResult result = compileShader(node, tools);
+		if (result.succeeded && source.has_value()) cache.record(node.sourcePath, *source, node.outputPath, settingsHash);
+		return result;
+	}
+
+	//empty if the dependencies loop back on themselves
+	std::optional<std::vector<size_t>> topologicalOrder(const BuildGraph &graph)
+	{
+		std::vector<size_t> remaining(graph.nodes.size());
+		std::vector<std::vector<size_t>> dependents(graph.nodes.size());
+		std::vector<size_t> order;
+		for (size_t i = 0; i < graph.nodes.size(); i++)
+		{
+			remaining[i] = graph.nodes[i].dependencies.size();
+			for (size_t dependency : graph.nodes[i].dependencies) dependents[dependency].push_back(i);
+			if (remaining[i] == 0) order.push_back(i);
+		}
+
+		for (size_t next = 0; next < order.size(); next++)
+		{
+			for (size_t dependent : dependents[order[next]])
+			{
+				if (--remaining[dependent] == 0) order.push_back(dependent);
+			}
+		}
+
+		if (order.size() != graph.nodes.size()) return std::nullopt;
+		return order;
+	}
+}
+
+BuildGraph gatherBuildGraph(const std::string &sourceRoot, const std::string &outputRoot)
+{
+	BuildGraph graph;
+	const fs::path sourcePath = fs::path(sourceRoot);
+	if (!fs::is_directory(sourcePath))
+	{
+		Logger::logErrorFormatted("Build input %s is not a directory", sourceRoot.c_str());
+		return graph;
+	}
+
+	for (const fs::directory_entry &entry : fs::recursive_directory_iterator(sourcePath))
+	{
+		if (!entry.is_regular_file()) continue;
+
+		const fs::path &path = entry.path();
+		const fs::path output = fs::path(outputRoot) / path.lexically_relative(sourcePath);
+		BuildNode node{ .sourcePath = normalizedPath(path) };
+
+		if (isShaderSource(path))
+		{
+			node.kind = BuildNode::Kind::shader;
+			node.outputPath = normalizedPath(output.string() + ".spv");
+			std::unordered_set<std::string> visited{ node.sourcePath };
+			gatherIncludes(path, visited, node.inputs);
+		}
+		else if (path.extension() == ".obj" || isTextureSource(path.string()))
+		{
+			node.kind = isTextureSource(path.string()) ? BuildNode::Kind::texture : BuildNode::Kind::mesh;
+			node.outputPath = normalizedPath(fs::path(output).replace_extension(compiledExtension(path.string())));
+			if (node.kind == BuildNode::Kind::mesh) gatherMaterialLibraries(path, node.inputs);
+		}
+		else
+		{
+			continue; //includes, materials and the like only matter through whatever reads them
+		}
+
+		graph.nodes.push_back(std::move(node));
+	}
+
+	//a node depends on whichever nodes write the files it reads
+	std::unordered_map<std::string, size_t> producers;
+	for (size_t i = 0; i < graph.nodes.size(); i++) producers.emplace(graph.nodes[i].outputPath, i);
+	for (BuildNode &node : graph.nodes)
+	{
+		for (const std::string &input : node.inputs)
+		{
+			const auto producer = producers.find(input);
+			if (producer != producers.end()) node.dependencies.push_back(producer->second);
+		}
+	}
+
+	return graph;
+}
+
+BuildReport runBuild(const BuildGraph &graph, const CompileOptions &options, const BuildTools &tools, size_t jobCount, AssetCache &cache)
+{
+	const size_t nodeCount = graph.nodes.size();
+	BuildReport report{ .results = std::vector<CompileResult>(nodeCount), .timings = std::vector<BuildNodeTiming>(nodeCount) };
+
+	if (!topologicalOrder(graph).has_value())
+	{
+		Logger::logError("Build graph has a dependency cycle, nothing was built");
+		for (size_t i = 0; i < nodeCount; i++) report.results[i] = CompileResult{ .sourcePath = graph.nodes[i].sourcePath, .destinationPath = graph.nodes[i].outputPath };
+		return report;
+	}
+
+	std::vector<size_t> remaining(nodeCount);
+	std::vector<std::vector<size_t>> dependents(nodeCount);
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		remaining[i] = graph.nodes[i].dependencies.size();
+		for (size_t dependency : graph.nodes[i].dependencies) dependents[dependency].push_back(i);
+	}
+
+	std::mutex mutex;
+	JobCounter nodesBuilt; //a node's dependents are scheduled before it finishes, so this only gets to zero once every node has
+
+	//nodePool's workers and the calling thread, which runs jobs while it waits, are the jobs, big meshes and textures split their work across workPool
+	//a node waiting on its own ranges only ever runs more of them, never another node, which would hold it up and end up in its timing
+	ThreadPool nodePool(std::max<size_t>(jobCount, 1) - 1);
+	ThreadPool workPool(std::max<size_t>(jobCount, 1) - 1);
+	const auto start = std::chrono::steady_clock::now();
+	auto millisecondsSinceStart = [&]() { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+	std::function<void(size_t)> schedule = [&](size_t i)
+	{
+		nodePool.submit([&, i]()
+		{
+			const BuildNode &node = graph.nodes[i];
+			report.timings[i].startMilliseconds = millisecondsSinceStart();
+
+			bool dependencyFailed = false;
+			{
+				std::scoped_lock lock(mutex);
+				for (size_t dependency : node.dependencies) dependencyFailed |= !report.results[dependency].succeeded;
+			}
+
+			CompileResult result = CompileResult{ .sourcePath = node.sourcePath, .destinationPath = node.outputPath };
+			if (dependencyFailed) Logger::logErrorFormatted("Skipping %s, something it depends on failed to build", node.sourcePath.c_str());
+			else result = buildNode(node, options, tools, cache, workPool);
+
+			report.timings[i].endMilliseconds = millisecondsSinceStart();
+
+			std::scoped_lock lock(mutex);
+			report.results[i] = std::move(result);
+			for (size_t dependent : dependents[i])
+			{
+				if (--remaining[dependent] == 0) schedule(dependent);
+			}
+		}, &nodesBuilt);
+	};
+
+	{
+		std::scoped_lock lock(mutex);
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			if (remaining[i] == 0) schedule(i);
+		}
+	}
+
+	nodePool.wait(nodesBuilt);
+	report.wallMilliseconds = millisecondsSinceStart();
+	return report;
+}
+
+void logCriticalPath(const BuildGraph &graph, const BuildReport &report)
+{
+	const std::optional<std::vector<size_t>> order = topologicalOrder(graph);
+	if (!order.has_value() || order->empty()) return;
+
+	//longest chain of node durations ending at each node, and the dependency it came through
+	std::vector<float> pathMilliseconds(graph.nodes.size());
+	std::vector<size_t> previous(graph.nodes.size(), SIZE_MAX);
+	float totalMilliseconds = 0.0f;
+	for (size_t i : *order)
+	{
+		const float duration = report.timings[i].endMilliseconds - report.timings[i].startMilliseconds;
+		totalMilliseconds += duration;
+		for (size_t dependency : graph.nodes[i].dependencies)
+		{
+			if (pathMilliseconds[dependency] > pathMilliseconds[i])
+			{
+				pathMilliseconds[i] = pathMilliseconds[dependency];
+				previous[i] = dependency;
+			}
+		}
+		pathMilliseconds[i] += duration;
+	}
+
+	std::vector<size_t> path{ (size_t)(std::max_element(pathMilliseconds.begin(), pathMilliseconds.end()) - pathMilliseconds.begin()) };
+	while (previous[path.back()] != SIZE_MAX) path.push_back(previous[path.back()]);
+	std::reverse(path.begin(), path.end());
+
+	Logger::logMessage("----- Critical path -----");
+	for (size_t i : path)
+	{
+		const BuildNodeTiming &timing = report.timings[i];
+		Logger::logMessageFormatted("%10.2f ms  %8.2f -> %8.2f  %s%s",
+			timing.endMilliseconds - timing.startMilliseconds,
+			timing.startMilliseconds,
+			timing.endMilliseconds,
+			graph.nodes[i].sourcePath.c_str(),
+			report.results[i].upToDate ? " (up to date)" : "");
+	}
+	Logger::logMessageFormatted("%zu nodes long, %.2f ms of %.2f ms wall, %.2f ms of work in total",
+		path.size(), pathMilliseconds[path.back()], report.wallMilliseconds, totalMilliseconds);
+}
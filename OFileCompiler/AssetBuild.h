@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Compiler.h"
+
+class AssetCache;
+
+//one output of an asset build and everything it is made from
+struct BuildNode
+{
+	enum class Kind : uint8_t { shader, mesh, texture };
+
+	Kind kind;
+	std::string sourcePath;
+	std::string outputPath;
+	std::vector<std::string> inputs; //files besides the source that change the output, like a shader's #includes or a mesh's .mtl files
+	std::vector<size_t> dependencies; //nodes whose outputs are among this one's inputs, they're built first
+};
+
+struct BuildGraph
+{
+	std::vector<BuildNode> nodes;
+};
+
+struct BuildTools
+{
+	std::string glslangValidator = "glslangValidator";
+};
+
+//shaders (.vert .frag .comp) compile to .spv next to their full name, .objs to .o and images to .tex, mirroring sourceRoot's layout inside outputRoot
+[[nodiscard]]
+BuildGraph gatherBuildGraph(const std::string &sourceRoot, const std::string &outputRoot);
+
+struct BuildNodeTiming
+{
+	float startMilliseconds = {};
+	float endMilliseconds = {};
+};
+
+struct BuildReport
+{
+	std::vector<CompileResult> results; //lines up with the graph's nodes
+	std::vector<BuildNodeTiming> timings; //since the start of the build
+	float wallMilliseconds = {};
+};
+
+//runs every out of date node once its dependencies are done, at most jobCount at a time
+//up to date nodes are only checked against the cache, and nodes downstream of a failure are skipped and count as failed
+[[nodiscard]]
+BuildReport runBuild(const BuildGraph &graph, const CompileOptions &options, const BuildTools &tools, size_t jobCount, AssetCache &cache);
+
+//logs the chain of dependent nodes that took the longest, which bounds the wall time however many jobs there are
+void logCriticalPath(const BuildGraph &graph, const BuildReport &report);
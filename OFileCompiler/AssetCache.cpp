@@ -0,0 +1,233 @@
+#include "AssetCache.h"
+#include "Files.h"
+#include "Logger/Logger.h"
+#include "Serializer.h"
+#include <lz4/xxhash.h>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr uint32_t databaseMagic = 0x4343464F; //"OFCC"
+	constexpr uint32_t databaseVersion = 1;
+	constexpr size_t entryNumbersSize = sizeof(uint64_t) * 6; //everything in an entry after its two strings
+
+	std::string normalizedPath(const std::string &path)
+	{
+		return fs::path(path).lexically_normal().generic_string();
+	}
+
+	struct FileStamp
+	{
+		uint64_t size;
+		int64_t writeTime;
+	};
+
+	std::optional<FileStamp> stampFile(const std::string &path)
+	{
+		std::error_code error;
+		const uintmax_t size = fs::file_size(path, error);
+		if (error) return std::nullopt;
+		const fs::file_time_type writeTime = fs::last_write_time(path, error);
+		if (error) return std::nullopt;
+
+		return FileStamp{ .size = size, .writeTime = (int64_t)writeTime.time_since_epoch().count() };
+	}
+
+	void writeString(StretchyStreamOut &stream, const std::string &string)
+	{
+		stream.setNext((uint32_t)string.size());
+		if (!string.empty()) stream.setNext(string.data(), string.size());
+	}
+
+	//nullopt if the length or the string itself would run past size, so a truncated or corrupt database is never read out of bounds
+	std::optional<std::string> readString(StreamIn &stream, size_t size)
+	{
+		if (size - stream.bytesRead() < sizeof(uint32_t)) return std::nullopt;
+		const uint32_t length = stream.getNext<uint32_t>();
+		if (size - stream.bytesRead() < length) return std::nullopt;
+
+		std::string string(length, '\0');
+		stream.getNext(string.data(), string.size());
+		return string;
+	}
+}
+
+AssetCache::AssetCache(std::string givenDatabasePath) : databasePath(std::move(givenDatabasePath))
+{
+	FileReader reader(databasePath);
+	if (reader.failed()) return;
+
+	std::vector<std::byte> contents = reader.readInto<std::vector<std::byte>>();
+	if (contents.size() < sizeof(uint32_t) * 2 + sizeof(uint64_t)) return;
+
+	StreamIn stream(contents.data(), contents.size());
+	if (stream.getNext<uint32_t>() != databaseMagic || stream.getNext<uint32_t>() != databaseVersion)
+	{
+		Logger::logWarningFormatted("Asset cache at %s is from another compiler version, rebuilding everything", databasePath.c_str());
+		return;
+	}
+
+	//every entry takes at least its two string lengths and its numbers, so a count that can't fit is garbage
+	const uint64_t entryCount = stream.getNext<uint64_t>();
+	if (entryCount > (contents.size() - stream.bytesRead()) / (sizeof(uint32_t) * 2 + entryNumbersSize))
+	{
+		Logger::logWarningFormatted("Asset cache at %s is corrupt, rebuilding everything", databasePath.c_str());
+		return;
+	}
+
+	entries.reserve(entryCount);
+	for (uint64_t i = 0; i < entryCount; i++)
+	{
+		std::optional<std::string> destination = readString(stream, contents.size());
+		std::optional<std::string> source = destination.has_value() ? readString(stream, contents.size()) : std::nullopt;
+		if (!source.has_value() || contents.size() - stream.bytesRead() < entryNumbersSize)
+		{
+			Logger::logWarningFormatted("Asset cache at %s is corrupt, rebuilding everything", databasePath.c_str());
+			entries.clear();
+			return;
+		}
+
+		Entry entry{ .sourcePath = std::move(*source) };
+		entry.sourceHash = stream.getNext<uint64_t>();
+		entry.sourceSize = stream.getNext<uint64_t>();
+		entry.sourceWriteTime = stream.getNext<int64_t>();
+		entry.settingsHash = stream.getNext<uint64_t>();
+		entry.destinationSize = stream.getNext<uint64_t>();
+		entry.destinationWriteTime = stream.getNext<int64_t>();
+		entries.emplace(std::move(*destination), std::move(entry));
+	}
+}
+
+bool AssetCache::isUpToDate(const std::string &sourcePath, const std::string &destinationPath, uint64_t settingsHash)
+{
+	Entry entry;
+	{
+		std::scoped_lock lock(mutex);
+		const auto it = entries.find(normalizedPath(destinationPath));
+		if (it == entries.end()) return false;
+		entry = it->second;
+	}
+
+	if (entry.settingsHash != settingsHash || entry.sourcePath != normalizedPath(sourcePath)) return false;
+
+	const std::optional<FileStamp> destinationStamp = stampFile(destinationPath);
+	if (!destinationStamp.has_value()
+		|| destinationStamp->size != entry.destinationSize
+		|| destinationStamp->writeTime != entry.destinationWriteTime)
+	{
+		return false; //the output was deleted or touched by something else
+	}
+
+	const std::optional<FileStamp> sourceStamp = stampFile(sourcePath);
+	if (!sourceStamp.has_value() || sourceStamp->size != entry.sourceSize) return false;
+	if (sourceStamp->writeTime == entry.sourceWriteTime) return true;
+
+	//the timestamp moved (checkout, copy...) but the contents might not have
+	if (hashFile(sourcePath) != entry.sourceHash) return false;
+
+	std::scoped_lock lock(mutex);
+	entries[normalizedPath(destinationPath)].sourceWriteTime = sourceStamp->writeTime;
+	dirty = true;
+	return true;
+}
+
+std::optional<AssetCache::SourceStamp> AssetCache::stampSource(const std::string &path)
+{
+	//stamped before it's hashed, so an edit in between shows up as a moved timestamp and gets the contents checked again
+	const std::optional<FileStamp> stamp = stampFile(path);
+	if (!stamp.has_value()) return std::nullopt;
+
+	return SourceStamp{ .hash = hashFile(path), .size = stamp->size, .writeTime = stamp->writeTime };
+}
+
+void AssetCache::record(const std::string &sourcePath, const SourceStamp &source, const std::string &destinationPath, uint64_t settingsHash)
+{
+	const std::optional<FileStamp> destinationStamp = stampFile(destinationPath);
+	if (!destinationStamp.has_value()) return;
+
+	Entry entry
+	{
+		.sourcePath = normalizedPath(sourcePath),
+		.sourceHash = source.hash,
+		.sourceSize = source.size,
+		.sourceWriteTime = source.writeTime,
+		.settingsHash = settingsHash,
+		.destinationSize = destinationStamp->size,
+		.destinationWriteTime = destinationStamp->writeTime,
+	};
+
+	std::scoped_lock lock(mutex);
+	entries[normalizedPath(destinationPath)] = std::move(entry);
+	dirty = true;
+}
+
+void AssetCache::clear()
+{
+	std::scoped_lock lock(mutex);
+	entries.clear();
+	dirty = true;
+}
+
+void AssetCache::forget(const std::string &destinationPath)
+{
+	std::scoped_lock lock(mutex);
+	if (entries.erase(normalizedPath(destinationPath)) != 0) dirty = true;
+}
+
+bool AssetCache::save() const
+{
+	std::scoped_lock lock(mutex);
+	if (!dirty) return true;
+
+	StretchyStreamOut stream;
+	stream.setNext(databaseMagic);
+	stream.setNext(databaseVersion);
+	stream.setNext((uint64_t)entries.size());
+	for (const auto &[destination, entry] : entries)
+	{
+		writeString(stream, destination);
+		writeString(stream, entry.sourcePath);
+		stream.setNext(entry.sourceHash);
+		stream.setNext(entry.sourceSize);
+		stream.setNext(entry.sourceWriteTime);
+		stream.setNext(entry.settingsHash);
+		stream.setNext(entry.destinationSize);
+		stream.setNext(entry.destinationWriteTime);
+	}
+
+	//write next to the database and swap it in, so an interrupted run can't leave a truncated cache behind
+	const std::string temporaryPath = databasePath + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary);
+		file.write((const char *)stream.getData(), stream.bytesWritten());
+		if (file.fail()) return false;
+	}
+
+	std::error_code error;
+	fs::rename(temporaryPath, databasePath, error);
+	return !error;
+}
+
+uint64_t AssetCache::hashFile(const std::string &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return 0;
+
+	XXH64_state_t *state = XXH64_createState();
+	XXH64_reset(state, 0);
+
+	std::vector<char> block(1 << 20);
+	while (file)
+	{
+		file.read(block.data(), block.size());
+		XXH64_update(state, block.data(), (size_t)file.gcount());
+	}
+
+	const uint64_t hash = XXH64_digest(state);
+	XXH64_freeState(state);
+	return hash;
+}
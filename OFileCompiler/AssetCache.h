@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+//sidecar database remembering which source produced each output and with which settings, so up to date outputs can be skipped
+class AssetCache
+{
+public:
+
+	explicit AssetCache(std::string givenDatabasePath);
+
+	//what a source looked like when it was read
+	struct SourceStamp
+	{
+		uint64_t hash;
+		uint64_t size;
+		int64_t writeTime;
+	};
+
+	//taken before compiling, so a source saved while it compiles is recorded as it was read and rebuilt next time
+	[[nodiscard]]
+	static std::optional<SourceStamp> stampSource(const std::string &path);
+
+	//cheap when nothing changed: only stats the source and destination, the source is hashed only if its timestamp moved
+	[[nodiscard]]
+	bool isUpToDate(const std::string &sourcePath, const std::string &destinationPath, uint64_t settingsHash);
+
+	void record(const std::string &sourcePath, const SourceStamp &source, const std::string &destinationPath, uint64_t settingsHash);
+
+	//forgets every entry, everything is rebuilt and recorded again
+	void clear();
+
+	//forgets the entry for one output, so only it is rebuilt
+	void forget(const std::string &destinationPath);
+
+	[[nodiscard]]
+	bool save() const;
+
+	[[nodiscard]]
+	static uint64_t hashFile(const std::string &path);
+
+private:
+
+	struct Entry
+	{
+		std::string sourcePath;
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+		uint64_t settingsHash;
+		uint64_t destinationSize;
+		int64_t destinationWriteTime;
+	};
+
+	std::string databasePath;
+	std::unordered_map<std::string, Entry> entries;
+	mutable std::mutex mutex;
+	bool dirty = false;
+};
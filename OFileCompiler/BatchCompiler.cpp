@@ -0,0 +1,158 @@
+#include "BatchCompiler.h"
+#include "ThreadPool.h"
+#include "AssetCache.h"
+#include "Logger/Logger.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	float compressionRatio(size_t payloadBytes, size_t compressedBytes)
+	{
+		return compressedBytes > 0 ? (float)payloadBytes / (float)compressedBytes : 0.0f;
+	}
+
+	std::string destinationFor(const fs::path &source, const fs::path &root, const fs::path &outputDirectory)
+	{
+		fs::path relative = source.lexically_relative(root);
+		if (relative.empty() || *relative.begin() == "..") relative = source.filename();
+		return (outputDirectory / relative).replace_extension(compiledExtension(source.string())).string();
+	}
+
+	uintmax_t sizeOrZero(const std::string &path)
+	{
+		std::error_code error;
+		const uintmax_t size = fs::file_size(path, error);
+		return error ? 0 : size;
+	}
+}
+
+std::vector<BatchJob> gatherBatchJobs(const std::string &input, const std::string &outputDirectory)
+{
+	std::vector<BatchJob> jobs;
+	const fs::path inputPath = fs::path(input);
+
+	if (fs::is_directory(inputPath))
+	{
+		for (const fs::directory_entry &entry : fs::recursive_directory_iterator(inputPath))
+		{
+			if (!entry.is_regular_file() || (entry.path().extension() != ".obj" && !isTextureSource(entry.path().string()))) continue;
+			jobs.push_back({ entry.path().string(), destinationFor(entry.path(), inputPath, outputDirectory) });
+		}
+	}
+	else
+	{
+		std::ifstream manifest(inputPath);
+		if (!manifest.is_open())
+		{
+			Logger::logErrorFormatted("Could not open batch input %s - it is neither a directory nor a manifest", input.c_str());
+			return jobs;
+		}
+
+		const fs::path manifestDirectory = inputPath.parent_path();
+		std::string line;
+		while (std::getline(manifest, line))
+		{
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (line.empty() || line.front() == '#') continue;
+
+			fs::path source = fs::path(line);
+			if (source.is_relative()) source = manifestDirectory / source;
+			jobs.push_back({ source.string(), destinationFor(source, manifestDirectory, outputDirectory) });
+		}
+	}
+
+	//biggest files first, so a huge mesh doesn't start last and leave every other worker idle
+	std::vector<std::pair<uintmax_t, BatchJob>> sizedJobs;
+	sizedJobs.reserve(jobs.size());
+	for (BatchJob &job : jobs) sizedJobs.emplace_back(sizeOrZero(job.sourcePath), std::move(job));
+	std::stable_sort(sizedJobs.begin(), sizedJobs.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+
+	jobs.clear();
+	for (auto &sizedJob : sizedJobs) jobs.push_back(std::move(sizedJob.second));
+
+	return jobs;
+}
+
+std::vector<CompileResult> compileBatch(const std::vector<BatchJob> &jobs, const CompileOptions &options, ThreadPool &pool, AssetCache *cache)
+{
+	std::vector<CompileResult> results(jobs.size());
+	pool.parallelFor(jobs.size(), [&](size_t i)
+	{
+		results[i] = cache != nullptr
+			? compileAssetCached(jobs[i].sourcePath, jobs[i].destinationPath, options, *cache, &pool)
+			: compileAsset(jobs[i].sourcePath, jobs[i].destinationPath, options, &pool);
+	});
+	return results;
+}
+
+void logBatchSummary(const std::vector<CompileResult> &results, float wallMilliseconds, size_t threadCount)
+{
+	Logger::logMessage("----- Batch summary -----");
+	Logger::logMessageFormatted("%-10s %10s %12s %12s %8s %10s %10s %10s %14s %14s  %s", "status", "ms", "source KB", "output KB", "ratio", "lz4 ms", "vertices", "indices", "ACMR", "ATVR", "file");
+
+	size_t failed = 0;
+	size_t upToDate = 0;
+	float totalMilliseconds = 0.0f;
+	uintmax_t totalSourceBytes = 0;
+	uintmax_t totalOutputBytes = 0;
+	size_t totalPayloadBytes = 0;
+	size_t totalCompressedBytes = 0;
+	float totalCompressionMilliseconds = 0.0f;
+
+	for (const CompileResult &result : results)
+	{
+		//a no-op rebuild of a big library shouldn't print a line per untouched file
+		if (result.upToDate)
+		{
+			upToDate++;
+			continue;
+		}
+
+		Logger::logMessageFormatted("%-10s %10.2f %12llu %12llu %8.2f %10.2f %10zu %10zu %6.3f->%6.3f %6.3f->%6.3f  %s",
+			result.succeeded ? "ok" : "FAILED",
+			result.milliseconds,
+			(unsigned long long)(result.sourceBytes / 1024),
+			(unsigned long long)(result.outputBytes / 1024),
+			compressionRatio(result.compression.payloadBytes, result.compression.compressedBytes),
+			result.compression.milliseconds,
+			result.vertexCount,
+			result.indexCount,
+			result.optimisation.before.acmr,
+			result.optimisation.after.acmr,
+			result.optimisation.before.atvr,
+			result.optimisation.after.atvr,
+			result.sourcePath.c_str());
+
+		if (!result.succeeded) failed++;
+		totalMilliseconds += result.milliseconds;
+		totalSourceBytes += result.sourceBytes;
+		totalOutputBytes += result.outputBytes;
+		totalPayloadBytes += result.compression.payloadBytes;
+		totalCompressedBytes += result.compression.compressedBytes;
+		totalCompressionMilliseconds += result.compression.milliseconds;
+	}
+
+	Logger::logMessageFormatted(
+		"%zu files (%zu up to date, %zu failed) on %zu threads: %.2f ms wall, %.2f ms of work (%.2fx), %llu KB in, %llu KB out",
+		results.size(),
+		upToDate,
+		failed,
+		threadCount,
+		wallMilliseconds,
+		totalMilliseconds,
+		wallMilliseconds > 0.0f ? totalMilliseconds / wallMilliseconds : 0.0f,
+		(unsigned long long)(totalSourceBytes / 1024),
+		(unsigned long long)(totalOutputBytes / 1024));
+
+	if (totalPayloadBytes == 0) return;
+	Logger::logMessageFormatted(
+		"Payloads compressed %.2f:1, %zu KB to %zu KB, in %.2f ms of work",
+		compressionRatio(totalPayloadBytes, totalCompressedBytes),
+		totalPayloadBytes / 1024,
+		totalCompressedBytes / 1024,
+		totalCompressionMilliseconds);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Compiler.h"
+
+class ThreadPool;
+class AssetCache;
+
+struct BatchJob
+{
+	std::string sourcePath;
+	std::string destinationPath;
+};
+
+//input is either a directory, which is searched recursively for .objs and images, or a manifest listing one source path per line
+//relative paths in a manifest are relative to the manifest itself; outputs mirror the input layout inside outputDirectory
+[[nodiscard]]
+std::vector<BatchJob> gatherBatchJobs(const std::string &input, const std::string &outputDirectory);
+
+//cache can be null to rebuild everything
+[[nodiscard]]
+std::vector<CompileResult> compileBatch(const std::vector<BatchJob> &jobs, const CompileOptions &options, ThreadPool &pool, AssetCache *cache);
+
+void logBatchSummary(const std::vector<CompileResult> &results, float wallMilliseconds, size_t threadCount);
@@ -0,0 +1,420 @@
+#include "Benchmarks.h"
+#include "ObjParser.h"
+#include "ObjProcessing.h"
+#include "VertexWelder.h"
+#include "ThreadPool.h"
+#include "Files.h"
+#include "OFileSerialization.h"
+#include "Serializer.h"
+#include "FrustumCulling.h"
+#include "MathUtils.h"
+#include <lz4/lz4.h>
+#include "Logger/Logger.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <unordered_map>
+
+namespace
+{
+	constexpr int repetitions = 5;
+
+	//best of a few runs, the first one usually pays for page faults
+	template<typename Function_t>
+	float bestMilliseconds(Function_t &&function)
+	{
+		float best = FLT_MAX;
+		for (int i = 0; i < repetitions; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			function();
+			best = std::min(best, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	void logThroughput(const char *name, float milliseconds, size_t bytes, float baselineMilliseconds)
+	{
+		Logger::logMessageFormatted("%-28s %10.2f ms %10.2f MB/s %8.2fx",
+			name,
+			milliseconds,
+			bytes / (milliseconds * 1000.0f),
+			baselineMilliseconds / milliseconds);
+	}
+
+	bool sameWeldedObj(const WeldedObj &a, const WeldedObj &b)
+	{
+		auto sameRun = [](const ObjFaceRun &x, const ObjFaceRun &y) { return x.firstIndex == y.firstIndex && x.shape == y.shape && x.material == y.material; };
+		return a.indices == b.indices
+			&& a.vertices.size() == b.vertices.size()
+			&& std::equal(a.vertices.begin(), a.vertices.end(), b.vertices.begin(), [](const ObjVertex &x, const ObjVertex &y) { return memcmp(&x, &y, sizeof(ObjVertex)) == 0; })
+			&& a.runs.size() == b.runs.size()
+			&& std::equal(a.runs.begin(), a.runs.end(), b.runs.begin(), sameRun)
+			&& a.shapeCount == b.shapeCount && a.hasUV == b.hasUV && a.hasNormals == b.hasNormals && a.hasColors == b.hasColors;
+	}
+
+	void logCullTiming(const char *name, float milliseconds, size_t objectCount, float baselineMilliseconds)
+	{
+		Logger::logMessageFormatted("%-28s %10.3f ms %10.0f objects/ms %8.2fx",
+			name,
+			milliseconds,
+			objectCount / milliseconds,
+			baselineMilliseconds / milliseconds);
+	}
+
+	void logTiming(const char *name, float milliseconds, size_t cornerCount, float baselineMilliseconds)
+	{
+		Logger::logMessageFormatted("%-28s %10.2f ms %10.2f Mcorners/s %8.2fx",
+			name,
+			milliseconds,
+			cornerCount / (milliseconds * 1000.0f),
+			baselineMilliseconds / milliseconds);
+	}
+}
+
+int benchmarkWeld(const std::string &objPath, ThreadPool &pool)
+{
+	ObjAttribute attrib;
+	std::vector<ObjShape> shapes;
+	if (!loadObj(objPath, attrib, shapes))
+	{
+		Logger::logErrorFormatted("Couldn't load .obj at %s!", objPath.c_str());
+		return -1;
+	}
+
+	const std::vector<ObjVertex> corners = gatherCorners(attrib, shapes, &pool);
+	Logger::logMessageFormatted("----- Welding %zu corners from %s, best of %d runs -----", corners.size(), objPath.c_str(), repetitions);
+
+	//what processObj used to do: a node based map with a weak hash, looked up twice per corner
+	size_t mapVertexCount = 0;
+	const float mapMilliseconds = bestMilliseconds([&]()
+	{
+		std::unordered_map<ObjVertex, uint32_t> uniqueVertices = {};
+		std::vector<uint32_t> indices = {};
+		for (const ObjVertex &vertex : corners)
+		{
+			if (uniqueVertices.count(vertex) == 0) uniqueVertices[vertex] = static_cast<uint32_t>(uniqueVertices.size());
+			indices.push_back(uniqueVertices[vertex]);
+		}
+		mapVertexCount = uniqueVertices.size();
+	});
+
+	WeldResult serial;
+	const float serialMilliseconds = bestMilliseconds([&]()
+	{
+		VertexWelder welder(corners.size() / 4);
+		serial.indices.clear();
+		serial.indices.reserve(corners.size());
+		for (const ObjVertex &vertex : corners) serial.indices.push_back(welder.weld(vertex));
+		serial.vertices = welder.takeVertices();
+	});
+
+	WeldResult parallel;
+	const float parallelMilliseconds = bestMilliseconds([&]() { parallel = weldParallel(corners, pool); });
+
+	logTiming("std::unordered_map", mapMilliseconds, corners.size(), mapMilliseconds);
+	logTiming("VertexWelder", serialMilliseconds, corners.size(), mapMilliseconds);
+	logTiming("weldParallel", parallelMilliseconds, corners.size(), mapMilliseconds);
+	Logger::logMessageFormatted("%zu unique vertices (%zu with the old map's float equality), parallel on %zu threads", serial.vertices.size(), mapVertexCount, pool.workerCount() + 1);
+
+	const bool identical = serial.indices == parallel.indices
+		&& serial.vertices.size() == parallel.vertices.size()
+		&& std::equal(serial.vertices.begin(), serial.vertices.end(), parallel.vertices.begin(), [](const ObjVertex &a, const ObjVertex &b) { return memcmp(&a, &b, sizeof(ObjVertex)) == 0; });
+
+	if (!identical)
+	{
+		Logger::logError("weldParallel doesn't match VertexWelder!");
+		return -1;
+	}
+
+	return 0;
+}
+
+int benchmarkParse(const std::string &objPath, ThreadPool &pool)
+{
+	std::error_code error;
+	const size_t fileBytes = std::filesystem::file_size(objPath, error);
+	Logger::logMessageFormatted("----- Parsing and welding %s, %zu KB, best of %d runs -----", objPath.c_str(), fileBytes / 1024, repetitions);
+
+	//everything the tinyobj path holds at its peak that can be seen from outside, tinyobj's own temporaries while parsing come on top
+	size_t tinyobjBytes = 0;
+	std::optional<WeldedObj> tinyobj;
+	const float tinyobjMilliseconds = bestMilliseconds([&]()
+	{
+		ObjAttribute attrib;
+		std::vector<ObjShape> shapes;
+		if (!loadObj(objPath, attrib, shapes))
+		{
+			tinyobj.reset();
+			return;
+		}
+
+		tinyobj = weldObj(attrib, shapes, &pool);
+
+		size_t cornerCount = 0;
+		tinyobjBytes = (attrib.vertices.size() + attrib.texcoords.size() + attrib.normals.size() + attrib.colors.size()) * sizeof(float);
+		for (const ObjShape &shape : shapes)
+		{
+			cornerCount += shape.mesh.indices.size();
+			tinyobjBytes += shape.mesh.indices.size() * sizeof(tinyobj::index_t) + shape.mesh.material_ids.size() * sizeof(int) + shape.mesh.num_face_vertices.size() + shape.mesh.smoothing_group_ids.size() * sizeof(unsigned int);
+		}
+		if (cornerCount >= parallelWeldThreshold) tinyobjBytes += cornerCount * sizeof(ObjVertex); //weldParallel's input
+		tinyobjBytes += tinyobj->indices.size() * sizeof(uint32_t) + tinyobj->vertices.size() * sizeof(ObjVertex);
+	});
+
+	ObjParseStatistics serialStatistics;
+	std::optional<WeldedObj> serial;
+	const float serialMilliseconds = bestMilliseconds([&]() { serial = parseObj(objPath, nullptr, &serialStatistics); });
+
+	ObjParseStatistics parallelStatistics;
+	std::optional<WeldedObj> parallel;
+	const float parallelMilliseconds = bestMilliseconds([&]() { parallel = parseObj(objPath, &pool, &parallelStatistics); });
+
+	if (!tinyobj.has_value() || !serial.has_value() || !parallel.has_value())
+	{
+		Logger::logErrorFormatted("Couldn't parse .obj at %s!", objPath.c_str());
+		return -1;
+	}
+
+	char parallelName[64];
+	snprintf(parallelName, sizeof(parallelName), "parseObj on %zu threads", pool.workerCount() + 1);
+
+	logThroughput("tinyobj and the welder", tinyobjMilliseconds, fileBytes, tinyobjMilliseconds);
+	logThroughput("parseObj on 1 thread", serialMilliseconds, fileBytes, tinyobjMilliseconds);
+	logThroughput(parallelName, parallelMilliseconds, fileBytes, tinyobjMilliseconds);
+	Logger::logMessageFormatted("Peak memory besides the file: at least %zu KB for tinyobj, %zu KB for parseObj in %zu chunks", tinyobjBytes / 1024, parallelStatistics.peakBytes / 1024, parallelStatistics.chunkCount);
+	Logger::logMessageFormatted("%zu vertices, %zu triangles", parallel->vertices.size(), parallel->indices.size() / 3);
+
+	if (!sameWeldedObj(*tinyobj, *serial) || !sameWeldedObj(*serial, *parallel))
+	{
+		Logger::logError("parseObj doesn't match tinyobj and the welder!");
+		return -1;
+	}
+
+	return 0;
+}
+
+int benchmarkLoad(const std::string &path, ThreadPool &pool)
+{
+	const std::optional<OFile::Mapped> probe = OFile::map(path.c_str());
+	if (!probe.has_value())
+	{
+		Logger::logErrorFormatted("Couldn't map .o at %s!", path.c_str());
+		return -1;
+	}
+
+	const OFile::Header header = probe->header();
+	const size_t payloadBytes = header.payloadBytes();
+	const size_t compressedBytes = probe->compressedPayload().size();
+
+	//stands in for the mapped VMA staging buffer the engine decompresses into
+	std::vector<std::byte> staging(payloadBytes);
+	if (!probe->decompressPayload(staging.data()))
+	{
+		Logger::logError("Decompression failed!");
+		return -1;
+	}
+
+	//the same payload as the single block format 4 wrote, to measure what chunking gains and costs
+	std::vector<std::byte> singleBlock(LZ4_compressBound((int)payloadBytes));
+	singleBlock.resize(LZ4_compress_default((const char *)staging.data(), (char *)singleBlock.data(), (int)payloadBytes, (int)singleBlock.size()));
+
+	Logger::logMessageFormatted("----- Loading %s, %zu KB in %zu chunks (%zu KB as one block), %zu KB decompressed, best of %d runs -----",
+		path.c_str(), compressedBytes / 1024, probe->chunkCount(), singleBlock.size() / 1024, payloadBytes / 1024, repetitions);
+
+	//the old path: the whole file into a vector, its one block decompressed into a second one, parsed into a third set element by element, then copied to staging
+	bool streamedSucceeded = true;
+	const float streamedMilliseconds = bestMilliseconds([&]()
+	{
+		FileReader reader(path);
+		std::vector<std::byte> fileBytes = reader.readInto<std::vector<std::byte>>();
+		streamedSucceeded &= fileBytes.size() >= compressedBytes;
+
+		std::vector<std::byte> payload(payloadBytes);
+		const int decompressedSize = LZ4_decompress_safe((const char *)singleBlock.data(), (char *)payload.data(), (int)singleBlock.size(), (int)payloadBytes);
+		streamedSucceeded &= decompressedSize == (int)payloadBytes;
+
+		StreamIn stream(payload.data(), payload.size());
+		std::vector<std::byte> vertices(header.vertexBytes());
+		std::vector<std::byte> indices(header.indexBytes());
+		stream.getNext(vertices.data(), vertices.size());
+		stream.getNext(indices.data(), indices.size());
+
+		memcpy(staging.data(), vertices.data(), vertices.size());
+		memcpy(staging.data() + vertices.size(), indices.data(), indices.size());
+	});
+
+	bool blockSucceeded = true;
+	const float blockMilliseconds = bestMilliseconds([&]()
+	{
+		const int decompressedSize = LZ4_decompress_safe((const char *)singleBlock.data(), (char *)staging.data(), (int)singleBlock.size(), (int)payloadBytes);
+		blockSucceeded &= decompressedSize == (int)payloadBytes;
+	});
+
+	bool serialSucceeded = true;
+	const float serialMilliseconds = bestMilliseconds([&]()
+	{
+		const std::optional<OFile::Mapped> file = OFile::map(path.c_str());
+		serialSucceeded &= file.has_value() && file->decompressPayload(staging.data());
+	});
+
+	bool parallelSucceeded = true;
+	const float parallelMilliseconds = bestMilliseconds([&]()
+	{
+		const std::optional<OFile::Mapped> file = OFile::map(path.c_str());
+		parallelSucceeded &= file.has_value() && file->decompressPayload(staging.data(), &pool);
+	});
+
+	if (!streamedSucceeded || !blockSucceeded || !serialSucceeded || !parallelSucceeded)
+	{
+		Logger::logError("Decompression failed!");
+		return -1;
+	}
+
+	char parallelName[64];
+	snprintf(parallelName, sizeof(parallelName), "chunks on %zu threads", pool.workerCount() + 1);
+
+	logThroughput("read, decompress, parse, copy", streamedMilliseconds, payloadBytes, streamedMilliseconds);
+	logThroughput("map, decompress to staging", serialMilliseconds, payloadBytes, streamedMilliseconds);
+
+	Logger::logMessage("----- Chunks against one block -----");
+	logThroughput("one block", blockMilliseconds, payloadBytes, blockMilliseconds);
+	logThroughput("chunks on 1 thread", serialMilliseconds, payloadBytes, blockMilliseconds);
+	logThroughput(parallelName, parallelMilliseconds, payloadBytes, blockMilliseconds);
+	return 0;
+}
+
+int benchmarkCull(size_t objectCount)
+{
+	//the engine's camera and projection, looking into a cube of objects it sits in the middle of
+	const mat4x4 view = mat4x4::lookAt({ .eye = { .0f, .0f, .0f }, .target = { .0f, .0f, 1.0f }, .up = { .0f, 1.0f, .0f } });
+	mat4x4 projection = mat4x4::perspective({ .fovX = math::degToRad(70.0f), .aspectRatio = 1700.0f / 900.0f, .zfar = 200.0f, .znear = .01f });
+	projection.at(1, 1) *= -1.0f;
+	const FrustumPlanes planes = extractFrustumPlanes(projection * view);
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> radius(.1f, 5.0f);
+	SphereBatch spheres;
+	spheres.reserve(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		spheres.push({ position(random), position(random), position(random) }, radius(random));
+	}
+
+	Logger::logMessageFormatted("----- Culling %zu spheres, best of %d runs -----", objectCount, repetitions);
+
+	std::vector<uint32_t> scalarVisible;
+	scalarVisible.reserve(objectCount);
+	const float scalarMilliseconds = bestMilliseconds([&]()
+	{
+		scalarVisible.clear();
+		cullSpheresScalar(planes, spheres, scalarVisible);
+	});
+
+	std::vector<uint32_t> simdVisible;
+	simdVisible.reserve(objectCount);
+	const float simdMilliseconds = bestMilliseconds([&]()
+	{
+		simdVisible.clear();
+		cullSpheres(planes, spheres, simdVisible);
+	});
+
+#if defined(__AVX__)
+	constexpr const char *simdName = "cullSpheres, avx";
+#else
+	constexpr const char *simdName = "cullSpheres, sse";
+#endif
+	logCullTiming("one at a time", scalarMilliseconds, objectCount, scalarMilliseconds);
+	logCullTiming(simdName, simdMilliseconds, objectCount, scalarMilliseconds);
+	Logger::logMessageFormatted("%zu of %zu visible", simdVisible.size(), objectCount);
+
+	if (scalarVisible != simdVisible)
+	{
+		Logger::logError("cullSpheres doesn't match culling one at a time!");
+		return -1;
+	}
+
+	return 0;
+}
+
+int benchmarkJobs(size_t maxThreadCount)
+{
+	constexpr size_t jobCount = 100'000;
+	constexpr size_t elementCount = 1 << 24;
+	constexpr size_t grainSize = 1 << 14;
+	constexpr size_t rangeCount = elementCount / grainSize;
+
+	Logger::logMessageFormatted("----- %zu empty jobs and a parallelForRanges over %zu elements on up to %zu threads, best of %d runs -----", jobCount, elementCount, maxThreadCount, repetitions);
+
+	std::vector<float> values(elementCount);
+	for (size_t i = 0; i < elementCount; i++) values[i] = static_cast<float>(i);
+
+	std::vector<size_t> threadCounts;
+	for (size_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2) threadCounts.push_back(threadCount);
+	threadCounts.push_back(maxThreadCount);
+
+	float oneThreadMilliseconds = 0.0f;
+	double oneThreadSum = 0.0;
+	for (size_t threadCount : threadCounts)
+	{
+		ThreadPool pool(threadCount - 1);
+
+		//dealt out across the deques in turn, like loading work the main thread hands to the pool
+		const float submittedMilliseconds = bestMilliseconds([&]()
+		{
+			JobCounter counter;
+			for (size_t i = 0; i < jobCount; i++) pool.submit([]() {}, &counter);
+			pool.wait(counter);
+		});
+
+		//all on one worker's deque, so everyone else only gets any by stealing
+		const float spawnedMilliseconds = bestMilliseconds([&]()
+		{
+			JobCounter counter;
+			pool.submit([&]()
+			{
+				for (size_t i = 0; i < jobCount; i++) pool.submit([]() {}, &counter);
+			}, &counter);
+			pool.wait(counter);
+		});
+
+		std::vector<double> rangeSums(rangeCount);
+		const float forMilliseconds = bestMilliseconds([&]()
+		{
+			pool.parallelForRanges(elementCount, grainSize, [&](size_t begin, size_t end)
+			{
+				double sum = 0.0;
+				for (size_t i = begin; i < end; i++) sum += sqrtf(values[i]);
+				rangeSums[begin / grainSize] = sum;
+			});
+		});
+
+		double sum = 0.0;
+		for (double rangeSum : rangeSums) sum += rangeSum;
+		if (threadCount == 1)
+		{
+			oneThreadMilliseconds = forMilliseconds;
+			oneThreadSum = sum;
+		}
+		else if (sum != oneThreadSum)
+		{
+			Logger::logErrorFormatted("parallelForRanges on %zu threads doesn't match one thread!", threadCount);
+			return -1;
+		}
+
+		Logger::logMessageFormatted("%3zu threads %10.0f submitted jobs/ms %10.0f spawned jobs/ms %10.2f ms parallelForRanges %6.2fx",
+			threadCount,
+			jobCount / submittedMilliseconds,
+			jobCount / spawnedMilliseconds,
+			forMilliseconds,
+			oneThreadMilliseconds / forMilliseconds);
+	}
+
+	return 0;
+}
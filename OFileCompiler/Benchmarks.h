@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+
+class ThreadPool;
+
+//each benchmark logs its timings and returns the process exit code, so main can hand it straight back
+
+//welds the corners of the .obj at objPath with the old std::unordered_map, VertexWelder and weldParallel, and checks they agree
+[[nodiscard]]
+int benchmarkWeld(const std::string &objPath, ThreadPool &pool);
+
+//parses the .obj at objPath with tinyobj and the welder, and with parseObj on one thread and across the pool, and checks they agree
+[[nodiscard]]
+int benchmarkParse(const std::string &objPath, ThreadPool &pool);
+
+//loads the .o at path the way OFile::load used to (read, decompress, parse into vectors, copy to staging) and through OFile::map straight into a staging sized buffer
+//then decompresses it as one LZ4 block like format 4 did, and chunk by chunk on one thread and across the pool
+[[nodiscard]]
+int benchmarkLoad(const std::string &path, ThreadPool &pool);
+
+//culls objectCount random spheres against the engine's frustum one at a time and with cullSpheres, and checks they agree
+[[nodiscard]]
+int benchmarkCull(size_t objectCount);
+
+//runs empty jobs submitted from outside the pool and spawned from inside a job, and a parallelForRanges over a big array
+//on 1, 2, 4 and so on threads up to maxThreadCount, and checks every thread count sums the array the same
+[[nodiscard]]
+int benchmarkJobs(size_t maxThreadCount);
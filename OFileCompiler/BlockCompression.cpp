@@ -0,0 +1,408 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#pragma warning(disable : 26451)
+
+namespace
+{
+	using Color = std::array<float, 4>;
+	using BlockColors = std::array<Color, 16>;
+
+	struct Endpoints
+	{
+		Color first = {};
+		Color last = {};
+	};
+
+	float squaredDistance(const Color &a, const Color &b)
+	{
+		float distance = 0.0f;
+		for (size_t channel = 0; channel < 4; channel++) distance += (a[channel] - b[channel]) * (a[channel] - b[channel]);
+		return distance;
+	}
+
+	Color clampColor(Color color)
+	{
+		for (float &channel : color) channel = std::clamp(channel, 0.0f, 255.0f);
+		return color;
+	}
+
+	//the line through the block's mean along its principal axis, cut where the outermost colors project onto it
+	//the axis comes from power iteration on the covariance, seeded with its row of greatest variance
+	Endpoints principalEndpoints(const BlockColors &colors)
+	{
+		Color mean = {};
+		for (const Color &color : colors)
+		{
+			for (size_t channel = 0; channel < 4; channel++) mean[channel] += color[channel] / 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (const Color &color : colors)
+		{
+			for (size_t i = 0; i < 4; i++)
+			{
+				for (size_t j = 0; j < 4; j++) covariance[i][j] += (color[i] - mean[i]) * (color[j] - mean[j]);
+			}
+		}
+
+		size_t seedRow = 0;
+		for (size_t i = 1; i < 4; i++)
+		{
+			if (covariance[i][i] > covariance[seedRow][seedRow]) seedRow = i;
+		}
+
+		Color axis = { covariance[seedRow][0], covariance[seedRow][1], covariance[seedRow][2], covariance[seedRow][3] };
+		for (size_t iteration = 0; iteration < 8; iteration++)
+		{
+			Color next = {};
+			for (size_t i = 0; i < 4; i++)
+			{
+				for (size_t j = 0; j < 4; j++) next[i] += covariance[i][j] * axis[j];
+			}
+
+			const float largest = std::max({ fabsf(next[0]), fabsf(next[1]), fabsf(next[2]), fabsf(next[3]) });
+			if (largest == 0.0f) break;
+			for (size_t i = 0; i < 4; i++) axis[i] = next[i] / largest;
+		}
+
+		const float axisLength = sqrtf(squaredDistance(axis, Color{}));
+		if (axisLength == 0.0f) return Endpoints{ .first = mean, .last = mean };
+		for (float &channel : axis) channel /= axisLength;
+
+		float minimum = std::numeric_limits<float>::max();
+		float maximum = std::numeric_limits<float>::lowest();
+		for (const Color &color : colors)
+		{
+			float projection = 0.0f;
+			for (size_t channel = 0; channel < 4; channel++) projection += (color[channel] - mean[channel]) * axis[channel];
+			minimum = std::min(minimum, projection);
+			maximum = std::max(maximum, projection);
+		}
+
+		Endpoints endpoints;
+		for (size_t channel = 0; channel < 4; channel++)
+		{
+			endpoints.first[channel] = mean[channel] + axis[channel] * maximum;
+			endpoints.last[channel] = mean[channel] + axis[channel] * minimum;
+		}
+		return Endpoints{ .first = clampColor(endpoints.first), .last = clampColor(endpoints.last) };
+	}
+
+	//the endpoints that best reproduce the colors, given how far each one sits from first to last
+	//false when the weights can't tell the endpoints apart, e.g. when every color got the same index
+	bool leastSquaresEndpoints(const BlockColors &colors, const std::array<float, 16> &weights, Endpoints &endpoints)
+	{
+		float firstFirst = 0.0f, firstLast = 0.0f, lastLast = 0.0f;
+		Color towardsFirst = {}, towardsLast = {};
+		for (size_t pixel = 0; pixel < 16; pixel++)
+		{
+			const float last = weights[pixel];
+			const float first = 1.0f - last;
+			firstFirst += first * first;
+			firstLast += first * last;
+			lastLast += last * last;
+			for (size_t channel = 0; channel < 4; channel++)
+			{
+				towardsFirst[channel] += first * colors[pixel][channel];
+				towardsLast[channel] += last * colors[pixel][channel];
+			}
+		}
+
+		const float determinant = firstFirst * lastLast - firstLast * firstLast;
+		if (fabsf(determinant) < 1e-6f) return false;
+
+		for (size_t channel = 0; channel < 4; channel++)
+		{
+			endpoints.first[channel] = (lastLast * towardsFirst[channel] - firstLast * towardsLast[channel]) / determinant;
+			endpoints.last[channel] = (firstFirst * towardsLast[channel] - firstLast * towardsFirst[channel]) / determinant;
+		}
+		endpoints.first = clampColor(endpoints.first);
+		endpoints.last = clampColor(endpoints.last);
+		return true;
+	}
+
+	BlockColors toColors(const PixelBlock &pixels, bool keepAlpha)
+	{
+		BlockColors colors;
+		for (size_t pixel = 0; pixel < 16; pixel++)
+		{
+			for (size_t channel = 0; channel < 4; channel++) colors[pixel][channel] = pixels[pixel * 4 + channel];
+			if (!keepAlpha) colors[pixel][3] = 0.0f;
+		}
+		return colors;
+	}
+
+	//bc1: two rgb565 endpoints and a 2 bit index per pixel into them and the two colors a third and two thirds between
+
+	uint16_t toRgb565(const Color &color)
+	{
+		const uint32_t r = (uint32_t)std::lround(color[0] * 31.0f / 255.0f);
+		const uint32_t g = (uint32_t)std::lround(color[1] * 63.0f / 255.0f);
+		const uint32_t b = (uint32_t)std::lround(color[2] * 31.0f / 255.0f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	Color fromRgb565(uint16_t packed)
+	{
+		const uint32_t r = (packed >> 11) & 31;
+		const uint32_t g = (packed >> 5) & 63;
+		const uint32_t b = packed & 31;
+		return { (float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)), 0.0f };
+	}
+
+	struct ColorBlock
+	{
+		uint16_t first = {};
+		uint16_t last = {};
+		uint32_t indices = {};
+		float error = std::numeric_limits<float>::max();
+	};
+
+	//how far towards the last endpoint each bc1 index is
+	constexpr std::array<float, 4> bc1Weights = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	//first has to be the greater endpoint, otherwise the block switches to the three color mode with a transparent black
+	ColorBlock fitColorBlock(const BlockColors &colors, uint16_t first, uint16_t last)
+	{
+		if (first < last) std::swap(first, last);
+
+		const Color firstColor = fromRgb565(first);
+		const Color lastColor = fromRgb565(last);
+		std::array<Color, 4> palette = { firstColor, lastColor };
+		for (size_t channel = 0; channel < 4; channel++)
+		{
+			palette[2][channel] = (2.0f * firstColor[channel] + lastColor[channel]) / 3.0f;
+			palette[3][channel] = (firstColor[channel] + 2.0f * lastColor[channel]) / 3.0f;
+		}
+		const size_t paletteSize = first == last ? 1 : 4;
+
+		ColorBlock block{ .first = first, .last = last, .error = 0.0f };
+		for (size_t pixel = 0; pixel < 16; pixel++)
+		{
+			uint32_t bestIndex = 0;
+			float bestDistance = squaredDistance(colors[pixel], palette[0]);
+			for (uint32_t index = 1; index < paletteSize; index++)
+			{
+				const float distance = squaredDistance(colors[pixel], palette[index]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = index;
+				}
+			}
+			block.indices |= bestIndex << (pixel * 2);
+			block.error += bestDistance;
+		}
+		return block;
+	}
+
+	void encodeColorBlock(const PixelBlock &pixels, std::byte *destination)
+	{
+		const BlockColors colors = toColors(pixels, false);
+		Endpoints endpoints = principalEndpoints(colors);
+
+		ColorBlock best;
+		for (size_t iteration = 0; iteration < 3; iteration++)
+		{
+			const ColorBlock candidate = fitColorBlock(colors, toRgb565(endpoints.first), toRgb565(endpoints.last));
+			if (candidate.error < best.error) best = candidate;
+			if (candidate.error == 0.0f || candidate.first == candidate.last) break;
+
+			std::array<float, 16> weights;
+			for (size_t pixel = 0; pixel < 16; pixel++) weights[pixel] = bc1Weights[(candidate.indices >> (pixel * 2)) & 3];
+			endpoints = Endpoints{ .first = fromRgb565(candidate.first), .last = fromRgb565(candidate.last) };
+			if (!leastSquaresEndpoints(colors, weights, endpoints)) break;
+		}
+
+		memcpy(destination, &best.first, sizeof(uint16_t));
+		memcpy(destination + 2, &best.last, sizeof(uint16_t));
+		memcpy(destination + 4, &best.indices, sizeof(uint32_t));
+	}
+
+	//bc4: two 8 bit endpoints and a 3 bit index per pixel into them and the six values evenly between
+	void encodeChannelBlock(const PixelBlock &pixels, size_t channel, std::byte *destination)
+	{
+		uint8_t minimum = 255, maximum = 0;
+		for (size_t pixel = 0; pixel < 16; pixel++)
+		{
+			minimum = std::min(minimum, pixels[pixel * 4 + channel]);
+			maximum = std::max(maximum, pixels[pixel * 4 + channel]);
+		}
+
+		uint64_t bits = (uint64_t)maximum | ((uint64_t)minimum << 8);
+		if (maximum != minimum)
+		{
+			std::array<float, 8> palette = { (float)maximum, (float)minimum };
+			for (size_t index = 2; index < 8; index++) palette[index] = ((8 - index) * (float)maximum + (index - 1) * (float)minimum) / 7.0f;
+
+			for (size_t pixel = 0; pixel < 16; pixel++)
+			{
+				const float value = pixels[pixel * 4 + channel];
+				uint64_t bestIndex = 0;
+				for (uint64_t index = 1; index < 8; index++)
+				{
+					if (fabsf(palette[index] - value) < fabsf(palette[bestIndex] - value)) bestIndex = index;
+				}
+				bits |= bestIndex << (16 + pixel * 3);
+			}
+		}
+
+		memcpy(destination, &bits, 8);
+	}
+
+	//bc7 mode 6: one subset of two rgba endpoints at 7 bits plus a shared low bit each, and a 4 bit index per pixel
+
+	constexpr std::array<uint32_t, 16> bc7Weights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct Mode6Endpoint
+	{
+		std::array<uint32_t, 4> quantised = {}; //7 bits per channel
+		uint32_t lowBit = {};
+
+		uint32_t channel(size_t channel) const { return (quantised[channel] << 1) | lowBit; }
+	};
+
+	Mode6Endpoint quantiseMode6(const Color &color)
+	{
+		Mode6Endpoint best;
+		float bestError = std::numeric_limits<float>::max();
+		for (uint32_t lowBit = 0; lowBit < 2; lowBit++)
+		{
+			Mode6Endpoint candidate{ .lowBit = lowBit };
+			float error = 0.0f;
+			for (size_t channel = 0; channel < 4; channel++)
+			{
+				candidate.quantised[channel] = (uint32_t)std::clamp(std::lround((color[channel] - lowBit) / 2.0f), 0l, 127l);
+				const float difference = (float)candidate.channel(channel) - color[channel];
+				error += difference * difference;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				best = candidate;
+			}
+		}
+		return best;
+	}
+
+	struct Mode6Block
+	{
+		Mode6Endpoint first = {};
+		Mode6Endpoint last = {};
+		std::array<uint8_t, 16> indices = {};
+		float error = std::numeric_limits<float>::max();
+	};
+
+	Mode6Block fitMode6Block(const BlockColors &colors, const Mode6Endpoint &first, const Mode6Endpoint &last)
+	{
+		std::array<Color, 16> palette;
+		for (size_t index = 0; index < 16; index++)
+		{
+			for (size_t channel = 0; channel < 4; channel++)
+			{
+				palette[index][channel] = (float)(((64 - bc7Weights[index]) * first.channel(channel) + bc7Weights[index] * last.channel(channel) + 32) >> 6);
+			}
+		}
+
+		Mode6Block block{ .first = first, .last = last, .error = 0.0f };
+		for (size_t pixel = 0; pixel < 16; pixel++)
+		{
+			uint8_t bestIndex = 0;
+			float bestDistance = squaredDistance(colors[pixel], palette[0]);
+			for (uint8_t index = 1; index < 16; index++)
+			{
+				const float distance = squaredDistance(colors[pixel], palette[index]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = index;
+				}
+			}
+			block.indices[pixel] = bestIndex;
+			block.error += bestDistance;
+		}
+		return block;
+	}
+
+	//bc7 blocks are read from the lowest bit of the first byte up
+	struct BitWriter
+	{
+		std::array<uint8_t, 16> bytes = {};
+		size_t position = 0;
+
+		void write(uint32_t value, size_t bitCount)
+		{
+			for (size_t bit = 0; bit < bitCount; bit++, position++)
+			{
+				if ((value >> bit) & 1) bytes[position / 8] |= (uint8_t)(1 << (position % 8));
+			}
+		}
+	};
+
+	void encodeMode6Block(const PixelBlock &pixels, std::byte *destination)
+	{
+		const BlockColors colors = toColors(pixels, true);
+		Endpoints endpoints = principalEndpoints(colors);
+
+		Mode6Block best;
+		for (size_t iteration = 0; iteration < 3; iteration++)
+		{
+			const Mode6Block candidate = fitMode6Block(colors, quantiseMode6(endpoints.first), quantiseMode6(endpoints.last));
+			if (candidate.error < best.error) best = candidate;
+			if (candidate.error == 0.0f) break;
+
+			std::array<float, 16> weights;
+			for (size_t pixel = 0; pixel < 16; pixel++) weights[pixel] = bc7Weights[candidate.indices[pixel]] / 64.0f;
+			if (!leastSquaresEndpoints(colors, weights, endpoints)) break;
+		}
+
+		//the first pixel's index has an implied 0 top bit, so the endpoints swap if it would be set
+		if (best.indices[0] >= 8)
+		{
+			std::swap(best.first, best.last);
+			for (uint8_t &index : best.indices) index = 15 - index;
+		}
+
+		BitWriter writer;
+		writer.write(1 << 6, 7);
+		for (size_t channel = 0; channel < 4; channel++)
+		{
+			writer.write(best.first.quantised[channel], 7);
+			writer.write(best.last.quantised[channel], 7);
+		}
+		writer.write(best.first.lowBit, 1);
+		writer.write(best.last.lowBit, 1);
+		writer.write(best.indices[0], 3);
+		for (size_t pixel = 1; pixel < 16; pixel++) writer.write(best.indices[pixel], 4);
+
+		memcpy(destination, writer.bytes.data(), writer.bytes.size());
+	}
+}
+
+void encodeBlock(TextureFormat format, const PixelBlock &pixels, std::byte *destination)
+{
+	switch (format)
+	{
+	case TextureFormat::rgba8:
+		//not a block format, the caller writes these pixel by pixel
+		break;
+	case TextureFormat::bc1:
+		encodeColorBlock(pixels, destination);
+		break;
+	case TextureFormat::bc3:
+		encodeChannelBlock(pixels, 3, destination);
+		encodeColorBlock(pixels, destination + 8);
+		break;
+	case TextureFormat::bc5:
+		encodeChannelBlock(pixels, 0, destination);
+		encodeChannelBlock(pixels, 1, destination + 8);
+		break;
+	case TextureFormat::bc7:
+		encodeMode6Block(pixels, destination);
+		break;
+	}
+}
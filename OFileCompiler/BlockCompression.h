@@ -0,0 +1,12 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "TextureFormat.h"
+
+//a 4x4 block of rgba8 pixels, row by row
+using PixelBlock = std::array<uint8_t, 16 * 4>;
+
+//writes textureFormatToBlockSize(format) bytes to destination, bc1 drops the alpha and bc5 keeps only red and green
+//endpoints come from the block's principal axis and are refined by least squares against the chosen indices, bc7 only uses mode 6
+void encodeBlock(TextureFormat format, const PixelBlock &pixels, std::byte *destination);
@@ -0,0 +1,21 @@
+#pragma once
+#include "TextureFormat.h"
+
+//everything besides the source that changes what the compiler outputs, folded into the asset cache's settings hash
+struct CompileOptions
+{
+	bool streamingParser = true; //the chunked parallel parser rather than tinyobj, they only disagree on concave polygons
+	bool optimise = true; //vertex cache, overdraw and vertex fetch ordering
+	bool compactAttributes = true; //half UVs, octahedral normals and unorm8 colors instead of 32 bit floats
+	bool quantisePositions = false; //unorm16 positions inside the mesh bounds, precise to 1/65535th of the bounds
+	bool splitPositions = false; //positions in a stream of their own ahead of the other attributes, for depth only and shadow passes
+	bool generateNormals = true; //area weighted smooth normals for .objs that have none
+	bool recomputeNormals = false; //generated normals even where the .obj has its own
+	bool generateTangents = false; //an extra attribute after the colors, the tangent with the bitangent's sign in w; needs UVs
+	bool meshlets = false; //meshlets for cluster culling, they regroup the triangles, which costs the vertex cache a little for meshes drawn whole
+	uint32_t lodCount = 3; //simplified levels after the full detail one, each aiming for half the triangles of the last
+	float lodError = 0.02f; //how far the first simplified level may stray from the surface, as a fraction of the mesh's size, doubling with each level after it
+	int compressionLevel = 0; //0 for fast LZ4, 1 to 12 for LZ4HC, which loads just as fast but compiles slower for smaller files
+	TextureFormat textureFormat = TextureFormat::bc7; //what textures are encoded in, bc5 ones are treated as normal maps
+	bool srgbTextures = true; //textures hold colors, so they're mipped in linear space and sampled through an sRGB format
+};
@@ -0,0 +1,208 @@
+#include "Compiler.h"
+#include "ObjParser.h"
+#include "ObjProcessing.h"
+#include "TextureProcessing.h"
+#include "AssetCache.h"
+#include "Logger/Logger.h"
+#include "Serializer.h"
+#include <lz4/xxhash.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+
+namespace
+{
+	//the whole file through tinyobj, then every corner through the welder
+	std::optional<WeldedObj> loadAndWeldObj(const std::string &path, ThreadPool *pool)
+	{
+		ObjAttribute attrib;
+		std::vector<ObjShape> shapes;
+		if (!loadObj(path, attrib, shapes)) return std::nullopt;
+		return weldObj(attrib, shapes, pool);
+	}
+}
+
+CompileResult compileObj(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, ThreadPool *pool)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	CompileResult result
+	{
+		.sourcePath = sourcePath,
+		.destinationPath = destinationPath
+	};
+
+	auto finish = [&](bool succeeded)
+	{
+		result.succeeded = succeeded;
+		result.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	};
+
+	if (!sourcePath.ends_with(".obj"))
+	{
+		Logger::logErrorFormatted("This asset compiler only parses .objs, %s is not one!", sourcePath.c_str());
+		return finish(false);
+	}
+
+	std::error_code error;
+	result.sourceBytes = std::filesystem::file_size(sourcePath, error);
+
+	std::optional<WeldedObj> obj = options.streamingParser ? parseObj(sourcePath, pool) : loadAndWeldObj(sourcePath, pool);
+	if (!obj.has_value())
+	{
+		Logger::logErrorFormatted("Couldn't load .obj at %s!", sourcePath.c_str());
+		return finish(false);
+	}
+
+	if (obj->vertices.empty())
+	{
+		Logger::logErrorFormatted("Model at %s has no faces!", sourcePath.c_str());
+		return finish(false);
+	}
+
+	const OFile::FileData processingResult = processObj(std::move(*obj), options, &result.optimisation);
+	result.vertexCount = processingResult.header.vertexAmount;
+	result.indexCount = processingResult.header.indexAmount;
+
+	const std::filesystem::path destinationDirectory = std::filesystem::path(destinationPath).parent_path();
+	if (!destinationDirectory.empty()) std::filesystem::create_directories(destinationDirectory, error);
+
+	if (!OFile::save(destinationPath.c_str(), processingResult, pool, options.compressionLevel, &result.compression))
+	{
+		Logger::logErrorFormatted("File %s could not be written to!", destinationPath.c_str());
+		return finish(false);
+	}
+
+	result.outputBytes = std::filesystem::file_size(destinationPath, error);
+
+	const OFile::CompressionStatistics &compression = result.compression;
+	Logger::logMessageFormatted(
+		"Compressed %zu KB to %zu KB (%.2f:1) with %s in %.2f ms",
+		compression.payloadBytes / 1024,
+		compression.compressedBytes / 1024,
+		compression.compressedBytes > 0 ? (float)compression.payloadBytes / compression.compressedBytes : 0.0f,
+		options.compressionLevel > 0 ? "LZ4HC" : "LZ4",
+		compression.milliseconds
+	);
+
+	return finish(true);
+}
+
+CompileResult compileTexture(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, ThreadPool *pool)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	CompileResult result
+	{
+		.sourcePath = sourcePath,
+		.destinationPath = destinationPath
+	};
+
+	auto finish = [&](bool succeeded)
+	{
+		result.succeeded = succeeded;
+		result.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	};
+
+	std::error_code error;
+	result.sourceBytes = std::filesystem::file_size(sourcePath, error);
+
+	const std::optional<Rgba8Image> image = loadImage(sourcePath);
+	if (!image.has_value())
+	{
+		Logger::logErrorFormatted("Couldn't load image at %s!", sourcePath.c_str());
+		return finish(false);
+	}
+
+	const TextureFile::FileData texture = processImage(image.value(), options, pool);
+
+	const std::filesystem::path destinationDirectory = std::filesystem::path(destinationPath).parent_path();
+	if (!destinationDirectory.empty()) std::filesystem::create_directories(destinationDirectory, error);
+
+	if (!TextureFile::save(destinationPath.c_str(), texture, pool, options.compressionLevel))
+	{
+		Logger::logErrorFormatted("File %s could not be written to!", destinationPath.c_str());
+		return finish(false);
+	}
+
+	result.outputBytes = std::filesystem::file_size(destinationPath, error);
+	return finish(true);
+}
+
+bool isTextureSource(const std::string &path)
+{
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char character) { return (char)std::tolower(character); });
+	return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+}
+
+std::string compiledExtension(const std::string &sourcePath)
+{
+	return isTextureSource(sourcePath) ? ".tex" : ".o";
+}
+
+CompileResult compileAsset(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, ThreadPool *pool)
+{
+	return isTextureSource(sourcePath) ? compileTexture(sourcePath, destinationPath, options, pool) : compileObj(sourcePath, destinationPath, options, pool);
+}
+
+CompileResult compileAssetCached(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, AssetCache &cache, ThreadPool *pool, const std::vector<std::string> &inputs)
+{
+	uint64_t settingsHash = compileSettingsHash(options, sourcePath);
+	if (!inputs.empty())
+	{
+		StretchyStreamOut settings;
+		settings.setNext(settingsHash);
+		for (const std::string &input : inputs)
+		{
+			settings.setNext(AssetCache::hashFile(input));
+		}
+		settingsHash = XXH64(settings.getData(), settings.bytesWritten(), 0);
+	}
+
+	if (cache.isUpToDate(sourcePath, destinationPath, settingsHash))
+	{
+		return CompileResult
+		{
+			.sourcePath = sourcePath,
+			.destinationPath = destinationPath,
+			.succeeded = true,
+			.upToDate = true
+		};
+	}
+
+	const std::optional<AssetCache::SourceStamp> source = AssetCache::stampSource(sourcePath);
+	CompileResult result = compileAsset(sourcePath, destinationPath, options, pool);
+	if (result.succeeded && source.has_value()) cache.record(sourcePath, *source, destinationPath, settingsHash);
+	return result;
+}
+
+uint64_t compileSettingsHash(const CompileOptions &options, const std::string &sourcePath)
+{
+	StretchyStreamOut settings;
+	settings.setNext(compilerVersion);
+	if (isTextureSource(sourcePath))
+	{
+		settings.setNext(options.textureFormat);
+		settings.setNext(options.srgbTextures);
+		settings.setNext(options.compressionLevel);
+		return XXH64(settings.getData(), settings.bytesWritten(), 0);
+	}
+
+	settings.setNext(options.streamingParser);
+	settings.setNext(options.optimise);
+	settings.setNext(options.compactAttributes);
+	settings.setNext(options.quantisePositions);
+	settings.setNext(options.splitPositions);
+	settings.setNext(options.generateNormals);
+	settings.setNext(options.recomputeNormals);
+	settings.setNext(options.generateTangents);
+	settings.setNext(options.meshlets);
+	settings.setNext(options.compressionLevel);
+	settings.setNext(options.lodCount);
+	settings.setNext(options.lodError);
+	return XXH64(settings.getData(), settings.bytesWritten(), 0);
+}
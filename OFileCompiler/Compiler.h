@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CompileOptions.h"
+#include "MeshOptimiser.h"
+#include "OFileSerialization.h"
+
+class AssetCache;
+class ThreadPool;
+
+//bump whenever the output of the compiler changes, so cached outputs get rebuilt
+constexpr uint32_t compilerVersion = 16;
+
+struct CompileResult
+{
+	std::string sourcePath{};
+	std::string destinationPath{};
+	bool succeeded = false;
+	bool upToDate = false;
+	float milliseconds = {};
+	uintmax_t sourceBytes = {};
+	uintmax_t outputBytes = {};
+	size_t vertexCount = {};
+	size_t indexCount = {};
+	OptimisationReport optimisation = {};
+	OFile::CompressionStatistics compression = {};
+};
+
+//loads the .obj at sourcePath, processes it and writes the resulting .o file to destinationPath
+//pool is optional and only used to split up the work on big meshes
+[[nodiscard]]
+CompileResult compileObj(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, ThreadPool *pool = nullptr);
+
+//loads the image at sourcePath, builds its mips and writes them encoded in options.textureFormat as a .tex file to destinationPath
+[[nodiscard]]
+CompileResult compileTexture(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, ThreadPool *pool = nullptr);
+
+//images stb_image can read become textures, everything else is compiled as an .obj
+[[nodiscard]]
+bool isTextureSource(const std::string &path);
+
+//".tex" or ".o", whichever sourcePath compiles to
+[[nodiscard]]
+std::string compiledExtension(const std::string &sourcePath);
+
+//compileTexture or compileObj, depending on what sourcePath is
+[[nodiscard]]
+CompileResult compileAsset(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, ThreadPool *pool = nullptr);
+
+//same as compileAsset, but skips the work if the cache knows destinationPath is up to date and records fresh outputs in it
+//the current contents of inputs, files besides the source that the output depends on, are part of what the cache checks
+[[nodiscard]]
+CompileResult compileAssetCached(const std::string &sourcePath, const std::string &destinationPath, const CompileOptions &options, AssetCache &cache, ThreadPool *pool = nullptr, const std::vector<std::string> &inputs = {});
+
+//everything that affects the output besides the source itself, only the options for sourcePath's kind of asset count
+[[nodiscard]]
+uint64_t compileSettingsHash(const CompileOptions &options, const std::string &sourcePath);
@@ -0,0 +1,77 @@
+#include "MeshBounds.h"
+#include <algorithm>
+#include <cmath>
+
+OFile::Bounds computeBounds(const std::vector<uint32_t> &indices, size_t first, size_t count, const std::vector<ObjVertex> &vertices)
+{
+	OFile::Bounds bounds;
+	if (count == 0) return bounds;
+
+	const size_t end = first + count;
+	auto positionAt = [&](size_t i) -> const vec3 & { return vertices[indices[i]].pos; };
+
+	bounds.minimum = positionAt(first);
+	bounds.maximum = bounds.minimum;
+	for (size_t i = first; i < end; i++)
+	{
+		const vec3 &position = positionAt(i);
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			bounds.minimum[axis] = std::min(bounds.minimum[axis], position[axis]);
+			bounds.maximum[axis] = std::max(bounds.maximum[axis], position[axis]);
+		}
+	}
+
+	auto furthestFrom = [&](const vec3 &point)
+	{
+		size_t furthest = first;
+		float furthestDistance = -1.0f;
+		for (size_t i = first; i < end; i++)
+		{
+			const vec3 offset = positionAt(i) - point;
+			const float distance = vec3::dot(offset, offset);
+			if (distance > furthestDistance)
+			{
+				furthest = i;
+				furthestDistance = distance;
+			}
+		}
+		return positionAt(furthest);
+	};
+
+	//Ritter: a sphere over two points far apart, grown just enough to take in every point left outside it
+	const vec3 start = furthestFrom(positionAt(first));
+	const vec3 opposite = furthestFrom(start);
+	vec3 ritterCenter = (start + opposite) * 0.5f;
+	float ritterRadius = (opposite - start).length() * 0.5f;
+	for (size_t i = first; i < end; i++)
+	{
+		const vec3 offset = positionAt(i) - ritterCenter;
+		const float distance = offset.length();
+		if (distance <= ritterRadius) continue;
+
+		const float grownRadius = (ritterRadius + distance) * 0.5f;
+		ritterCenter += offset * ((grownRadius - ritterRadius) / distance);
+		ritterRadius = grownRadius;
+	}
+
+	//both radii are measured again rather than trusted, so rounding in the growth can't leave a vertex poking out
+	auto radiusAround = [&](const vec3 &center)
+	{
+		float radiusSquared = 0.0f;
+		for (size_t i = first; i < end; i++)
+		{
+			const vec3 offset = positionAt(i) - center;
+			radiusSquared = std::max(radiusSquared, vec3::dot(offset, offset));
+		}
+		return std::sqrt(radiusSquared);
+	};
+
+	const vec3 boxCenter = (bounds.minimum + bounds.maximum) * 0.5f;
+	const float boxRadius = radiusAround(boxCenter);
+	ritterRadius = radiusAround(ritterCenter);
+
+	bounds.center = ritterRadius < boxRadius ? ritterCenter : boxCenter;
+	bounds.radius = std::min(ritterRadius, boxRadius);
+	return bounds;
+}
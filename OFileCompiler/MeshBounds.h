@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ObjVertex.h"
+#include "OFileSerialization.h"
+
+//bounds of the vertices that indices[first, first + count) use
+//the sphere is centred on either the box's centre or Ritter's (1990) approximation, whichever gives the smaller radius
+[[nodiscard]]
+OFile::Bounds computeBounds(const std::vector<uint32_t> &indices, size_t first, size_t count, const std::vector<ObjVertex> &vertices);
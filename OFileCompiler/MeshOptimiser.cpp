@@ -0,0 +1,234 @@
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	constexpr uint32_t noVertex = UINT32_MAX;
+}
+
+Adjacency buildAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount)
+{
+	Adjacency adjacency
+	{
+		.offsets = std::vector<uint32_t>(vertexCount + 1, 0),
+		.triangles = std::vector<uint32_t>(indices.size())
+	};
+
+	for (const uint32_t index : indices) adjacency.offsets[index + 1]++;
+	std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+	std::vector<uint32_t> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) adjacency.triangles[cursors[indices[i]]++] = (uint32_t)(i / 3);
+
+	return adjacency;
+}
+
+VertexCacheStatistics simulateVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize)
+{
+	if (indices.empty() || vertexCount == 0) return {};
+
+	//a vertex is in the FIFO if it was pushed less than cacheSize pushes ago
+	std::vector<size_t> pushedAt(vertexCount, 0);
+	size_t pushes = cacheSize + 1;
+	size_t transformed = 0;
+
+	for (const uint32_t index : indices)
+	{
+		if (pushes - pushedAt[index] <= cacheSize) continue;
+		pushedAt[index] = pushes++;
+		transformed++;
+	}
+
+	return VertexCacheStatistics
+	{
+		.acmr = (float)transformed / (float)(indices.size() / 3),
+		.atvr = (float)transformed / (float)vertexCount
+	};
+}
+
+void optimiseVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t> *clusterStarts)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) return;
+
+	const Adjacency adjacency = buildAdjacency(indices, vertexCount);
+
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) liveTriangles[i] = adjacency.offsets[i + 1] - adjacency.offsets[i];
+
+	std::vector<size_t> cacheTimes(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	size_t time = cacheSize + 1;
+	uint32_t scanCursor = 0;
+
+	//once the fan around the current vertex is done, jump back to a recent vertex or scan forward for any live one
+	auto skipDeadEnd = [&]() -> uint32_t
+	{
+		while (!deadEnds.empty())
+		{
+			const uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0) return vertex;
+		}
+
+		for (; scanCursor < vertexCount; scanCursor++)
+		{
+			if (liveTriangles[scanCursor] > 0) return scanCursor;
+		}
+
+		return noVertex;
+	};
+
+	uint32_t fanning = skipDeadEnd();
+	if (clusterStarts != nullptr) clusterStarts->push_back(0);
+
+	while (fanning != noVertex)
+	{
+		candidates.clear();
+		for (uint32_t i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning + 1]; i++)
+		{
+			const uint32_t triangle = adjacency.triangles[i];
+			if (emitted[triangle]) continue;
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+
+				if (time - cacheTimes[vertex] > cacheSize) cacheTimes[vertex] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		//prefer the candidate that stays in the cache longest while it still has triangles to emit
+		uint32_t next = noVertex;
+		size_t bestPriority = 0;
+		for (const uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0) continue;
+
+			size_t priority = 0;
+			if (time - cacheTimes[vertex] + 2 * liveTriangles[vertex] <= cacheSize) priority = time - cacheTimes[vertex];
+			if (priority > bestPriority || next == noVertex)
+			{
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == noVertex)
+		{
+			next = skipDeadEnd();
+			if (next != noVertex && clusterStarts != nullptr && result.size() / 3 < triangleCount) clusterStarts->push_back((uint32_t)(result.size() / 3));
+		}
+
+		fanning = next;
+	}
+
+	indices = std::move(result);
+}
+
+void optimiseOverdraw(std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, const std::vector<uint32_t> &clusterStarts, float threshold, uint32_t cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (clusterStarts.size() < 2) return;
+
+	struct Cluster
+	{
+		uint32_t begin;
+		uint32_t end;
+		float sortKey;
+	};
+
+	auto trianglePosition = [&](size_t triangle, size_t corner) { return vertices[indices[triangle * 3 + corner]].pos; };
+
+	vec3 meshCentroid = {};
+	float meshArea = 0.0f;
+	std::vector<Cluster> clusters;
+	std::vector<std::pair<vec3, vec3>> clusterCentroidsAndNormals;
+	clusters.reserve(clusterStarts.size());
+
+	for (size_t i = 0; i < clusterStarts.size(); i++)
+	{
+		Cluster cluster
+		{
+			.begin = clusterStarts[i],
+			.end = i + 1 < clusterStarts.size() ? clusterStarts[i + 1] : (uint32_t)triangleCount
+		};
+
+		//area weighted, so slivers don't drag the centroid around
+		vec3 centroid = {};
+		vec3 normal = {};
+		float area = 0.0f;
+		for (uint32_t triangle = cluster.begin; triangle < cluster.end; triangle++)
+		{
+			const vec3 a = trianglePosition(triangle, 0);
+			const vec3 b = trianglePosition(triangle, 1);
+			const vec3 c = trianglePosition(triangle, 2);
+			const vec3 scaledNormal = vec3::cross(b - a, c - a);
+			const float triangleArea = scaledNormal.length();
+
+			centroid += (a + b + c) * (triangleArea / 3.0f);
+			normal += scaledNormal;
+			area += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+		if (area > 0.0f) centroid /= area;
+
+		clusters.push_back(cluster);
+		clusterCentroidsAndNormals.emplace_back(centroid, normal);
+	}
+
+	if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+	for (size_t i = 0; i < clusters.size(); i++)
+	{
+		const auto &[centroid, normal] = clusterCentroidsAndNormals[i];
+		const float normalLength = normal.length();
+		clusters[i].sortKey = normalLength > 0.0f ? vec3::dot(centroid - meshCentroid, normal) / normalLength : 0.0f;
+	}
+
+	//most outward facing first
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (const Cluster &cluster : clusters)
+	{
+		sorted.insert(sorted.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+	}
+
+	const float currentAcmr = simulateVertexCache(indices, vertices.size(), cacheSize).acmr;
+	const float sortedAcmr = simulateVertexCache(sorted, vertices.size(), cacheSize).acmr;
+	if (sortedAcmr <= currentAcmr * threshold) indices = std::move(sorted);
+}
+
+void optimiseVertexFetch(std::vector<uint32_t> &indices, std::vector<ObjVertex> &vertices)
+{
+	std::vector<uint32_t> remap(vertices.size(), noVertex);
+	std::vector<ObjVertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (uint32_t &index : indices)
+	{
+		if (remap[index] == noVertex)
+		{
+			remap[index] = (uint32_t)reordered.size();
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(reordered);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ObjVertex.h"
+
+//roughly what current GPUs keep of post-transform vertices, used both to optimise and to measure
+constexpr uint32_t defaultVertexCacheSize = 16;
+
+struct VertexCacheStatistics
+{
+	float acmr = {}; //transformed vertices per triangle, 0.5 is the ideal for a big regular grid, 3 is the worst
+	float atvr = {}; //transformed vertices per unique vertex, 1 is the ideal
+};
+
+struct OptimisationReport
+{
+	VertexCacheStatistics before = {};
+	VertexCacheStatistics after = {};
+};
+
+//triangles touching each vertex, as one flat array with per-vertex offsets
+struct Adjacency
+{
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+};
+
+[[nodiscard]]
+Adjacency buildAdjacency(const std::vector<uint32_t> &indices, size_t vertexCount);
+
+//replays indices through a FIFO cache of cacheSize entries
+[[nodiscard]]
+VertexCacheStatistics simulateVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = defaultVertexCacheSize);
+
+//reorders triangles for the post-transform cache using Tipsify (Sander et al. 2007)
+//clusterStarts, when given, receives the first triangle of every run that starts after a cache flush, which is where the overdraw pass may cut
+void optimiseVertexCache(std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = defaultVertexCacheSize, std::vector<uint32_t> *clusterStarts = nullptr);
+
+//sorts the clusters found by optimiseVertexCache so the ones facing away from the mesh centre are drawn first and occlude the rest
+//the new order is only kept if the ACMR gets no worse than threshold times the current one
+void optimiseOverdraw(std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, const std::vector<uint32_t> &clusterStarts, float threshold = 1.05f, uint32_t cacheSize = defaultVertexCacheSize);
+
+//reorders vertices by first use in indices, so the vertex fetch walks memory forwards
+void optimiseVertexFetch(std::vector<uint32_t> &indices, std::vector<ObjVertex> &vertices);
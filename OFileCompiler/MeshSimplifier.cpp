@@ -0,0 +1,429 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+	constexpr uint32_t noVertex = UINT32_MAX;
+
+	//how much harder an open border is to move than the surface around it
+	constexpr double borderWeight = 10.0;
+	//a collapse whose ends have opposite normals or colors costs as much as moving the surface by this fraction of the edge
+	constexpr double attributeWeight = 0.5;
+	//a triangle whose normal turns further than ~75 degrees counts as flipped
+	constexpr float flipCosine = 0.25f;
+
+	enum class VertexKind : uint8_t
+	{
+		manifold, //free to collapse onto any neighbour
+		border, //on an open edge, only collapses along it
+		seam, //one of two vertices sharing a position with different attributes, only collapses along the seam, together with its twin
+		locked
+	};
+
+	//sum of squared distances to planes, as ax^2 + by^2 + ... so they can be added together
+	struct Quadric
+	{
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+
+		//the plane dot(normal, p) + d = 0, normal being unit length
+		static Quadric fromPlane(const vec3 &normal, double d, double weight)
+		{
+			const double x = normal.x(), y = normal.y(), z = normal.z();
+			return Quadric
+			{
+				.a00 = weight * x * x, .a11 = weight * y * y, .a22 = weight * z * z,
+				.a01 = weight * x * y, .a02 = weight * x * z, .a12 = weight * y * z,
+				.b0 = weight * x * d, .b1 = weight * y * d, .b2 = weight * z * d,
+				.c = weight * d * d,
+				.weight = weight
+			};
+		}
+
+		void operator+=(const Quadric &other)
+		{
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a01 += other.a01; a02 += other.a02; a12 += other.a12;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		//weighted mean of the squared distances from position to the planes
+		[[nodiscard]]
+		double error(const vec3 &position) const
+		{
+			const double x = position.x(), y = position.y(), z = position.z();
+			const double squaredDistance =
+				x * (a00 * x + a01 * y + a02 * z) +
+				y * (a01 * x + a11 * y + a12 * z) +
+				z * (a02 * x + a12 * y + a22 * z) +
+				2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return weight > 0.0 ? std::fabs(squaredDistance) / weight : 0.0;
+		}
+	};
+
+	//the directed edges of every triangle, as each vertex's list of edge ends
+	struct EdgeAdjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> ends;
+
+		[[nodiscard]]
+		bool hasEdge(uint32_t from, uint32_t to) const
+		{
+			for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+			{
+				if (ends[i] == to) return true;
+			}
+			return false;
+		}
+	};
+
+	EdgeAdjacency buildEdges(const std::vector<uint32_t> &indices, size_t vertexCount)
+	{
+		EdgeAdjacency edges
+		{
+			.offsets = std::vector<uint32_t>(vertexCount + 1, 0),
+			.ends = std::vector<uint32_t>(indices.size())
+		};
+
+		for (const uint32_t index : indices) edges.offsets[index + 1]++;
+		std::partial_sum(edges.offsets.begin(), edges.offsets.end(), edges.offsets.begin());
+
+		std::vector<uint32_t> cursors(edges.offsets.begin(), edges.offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const size_t next = i % 3 == 2 ? i - 2 : i + 1;
+			edges.ends[cursors[indices[i]]++] = indices[next];
+		}
+
+		return edges;
+	}
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	//the simplifier's view of the vertices it works on, compacted to the ones the indices use
+	struct LocalMesh
+	{
+		std::vector<vec3> positions;
+		std::vector<vec3> normals;
+		std::vector<vec3> colors;
+		std::vector<uint32_t> remap; //the first vertex with the same position, shared positions share a quadric
+		std::vector<uint32_t> wedges; //the next vertex with the same position, forming a ring
+	};
+
+	LocalMesh buildLocalMesh(const std::vector<uint32_t> &toGlobal, const std::vector<ObjVertex> &vertices)
+	{
+		const size_t vertexCount = toGlobal.size();
+		LocalMesh mesh
+		{
+			.positions = std::vector<vec3>(vertexCount),
+			.normals = std::vector<vec3>(vertexCount),
+			.colors = std::vector<vec3>(vertexCount),
+			.remap = std::vector<uint32_t>(vertexCount),
+			.wedges = std::vector<uint32_t>(vertexCount)
+		};
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			const ObjVertex &vertex = vertices[toGlobal[i]];
+			mesh.positions[i] = vertex.pos;
+			mesh.normals[i] = vertex.normal;
+			mesh.colors[i] = vertex.color;
+		}
+
+		//group the vertices with bit identical positions, the welder already made equal positions identical
+		std::vector<uint32_t> byPosition(vertexCount);
+		std::iota(byPosition.begin(), byPosition.end(), 0);
+		auto comparePositions = [&](uint32_t a, uint32_t b) { return memcmp(&mesh.positions[a], &mesh.positions[b], sizeof(vec3)); };
+		std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) { const int order = comparePositions(a, b); return order < 0 || (order == 0 && a < b); });
+
+		for (size_t begin = 0, end = 0; begin < vertexCount; begin = end)
+		{
+			for (end = begin + 1; end < vertexCount && comparePositions(byPosition[begin], byPosition[end]) == 0; end++);
+			for (size_t i = begin; i < end; i++)
+			{
+				mesh.remap[byPosition[i]] = byPosition[begin];
+				mesh.wedges[byPosition[i]] = byPosition[i + 1 < end ? i + 1 : begin];
+			}
+		}
+
+		return mesh;
+	}
+
+	//whether there's an edge from the position of from to the position of to, through any of their wedges
+	bool hasPositionEdge(const LocalMesh &mesh, const EdgeAdjacency &edges, uint32_t from, uint32_t to)
+	{
+		uint32_t wedge = from;
+		do
+		{
+			for (uint32_t i = edges.offsets[wedge]; i < edges.offsets[wedge + 1]; i++)
+			{
+				if (mesh.remap[edges.ends[i]] == mesh.remap[to]) return true;
+			}
+			wedge = mesh.wedges[wedge];
+		} while (wedge != from);
+		return false;
+	}
+
+	std::vector<VertexKind> classifyVertices(const LocalMesh &mesh, const EdgeAdjacency &edges, const std::vector<bool> &locked)
+	{
+		const size_t vertexCount = mesh.positions.size();
+
+		//edges without a twin running the other way, and whether that holds for the positions too, i.e. whether they're borders rather than seams
+		std::vector<uint32_t> openOut(vertexCount, 0);
+		std::vector<uint32_t> openIn(vertexCount, 0);
+		std::vector<uint32_t> borderEdges(vertexCount, 0);
+		for (uint32_t from = 0; from < vertexCount; from++)
+		{
+			for (uint32_t i = edges.offsets[from]; i < edges.offsets[from + 1]; i++)
+			{
+				const uint32_t to = edges.ends[i];
+				if (edges.hasEdge(to, from)) continue;
+
+				openOut[from]++;
+				openIn[to]++;
+				if (!hasPositionEdge(mesh, edges, to, from))
+				{
+					borderEdges[from]++;
+					borderEdges[to]++;
+				}
+			}
+		}
+
+		auto isSimpleOpen = [&](uint32_t vertex) { return openOut[vertex] == 1 && openIn[vertex] == 1; };
+
+		std::vector<VertexKind> kinds(vertexCount, VertexKind::locked);
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			if (locked[vertex]) continue;
+
+			const uint32_t twin = mesh.wedges[vertex];
+			if (twin == vertex)
+			{
+				if (openOut[vertex] == 0 && openIn[vertex] == 0) kinds[vertex] = VertexKind::manifold;
+				else if (isSimpleOpen(vertex) && borderEdges[vertex] == 2) kinds[vertex] = VertexKind::border;
+			}
+			else if (mesh.wedges[twin] == vertex && !locked[twin] && isSimpleOpen(vertex) && isSimpleOpen(twin) && borderEdges[vertex] == 0 && borderEdges[twin] == 0)
+			{
+				kinds[vertex] = VertexKind::seam;
+			}
+		}
+
+		return kinds;
+	}
+
+	[[nodiscard]]
+	bool flipsTriangles(const std::vector<uint32_t> &indices, const Adjacency &triangles, const LocalMesh &mesh, uint32_t from, uint32_t to)
+	{
+		for (uint32_t i = triangles.offsets[from]; i < triangles.offsets[from + 1]; i++)
+		{
+			const uint32_t *corners = indices.data() + triangles.triangles[i] * 3;
+			if (corners[0] == to || corners[1] == to || corners[2] == to) continue; //collapses away
+
+			vec3 moved[3] = { mesh.positions[corners[0]], mesh.positions[corners[1]], mesh.positions[corners[2]] };
+			const vec3 before = vec3::cross(moved[1] - moved[0], moved[2] - moved[0]);
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				if (corners[corner] == from) moved[corner] = mesh.positions[to];
+			}
+			const vec3 after = vec3::cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+			if (vec3::dot(before, after) < flipCosine * before.length() * after.length()) return true;
+		}
+		return false;
+	}
+}
+
+SimplifyResult simplify(const std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, const std::vector<bool> &locked, size_t targetIndexCount, float maxError)
+{
+	//work on only the vertices these indices use, so simplifying one small submesh of a big mesh stays cheap
+	std::vector<uint32_t> toGlobal(indices);
+	std::sort(toGlobal.begin(), toGlobal.end());
+	toGlobal.erase(std::unique(toGlobal.begin(), toGlobal.end()), toGlobal.end());
+	const size_t vertexCount = toGlobal.size();
+
+	std::vector<uint32_t> result(indices.size());
+	for (size_t i = 0; i < indices.size(); i++) result[i] = (uint32_t)(std::lower_bound(toGlobal.begin(), toGlobal.end(), indices[i]) - toGlobal.begin());
+
+	std::vector<bool> localLocked(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) localLocked[i] = locked[toGlobal[i]];
+
+	const LocalMesh mesh = buildLocalMesh(toGlobal, vertices);
+	const EdgeAdjacency sourceEdges = buildEdges(result, vertexCount);
+	const std::vector<VertexKind> kinds = classifyVertices(mesh, sourceEdges, localLocked);
+
+	//every triangle's plane goes to its corners, open borders get a plane standing on them too so they keep their outline
+	std::vector<Quadric> quadrics(vertexCount);
+	{
+		for (size_t triangle = 0; triangle < result.size() / 3; triangle++)
+		{
+			const uint32_t *corners = result.data() + triangle * 3;
+			const vec3 scaledNormal = vec3::cross(mesh.positions[corners[1]] - mesh.positions[corners[0]], mesh.positions[corners[2]] - mesh.positions[corners[0]]);
+			const float doubleArea = scaledNormal.length();
+			if (doubleArea == 0.0f) continue;
+
+			const vec3 normal = scaledNormal / doubleArea;
+			const Quadric plane = Quadric::fromPlane(normal, -vec3::dot(normal, mesh.positions[corners[0]]), doubleArea * 0.5);
+			for (size_t corner = 0; corner < 3; corner++) quadrics[mesh.remap[corners[corner]]] += plane;
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t from = corners[corner];
+				const uint32_t to = corners[(corner + 1) % 3];
+				if (hasPositionEdge(mesh, sourceEdges, to, from)) continue;
+
+				const vec3 edge = mesh.positions[to] - mesh.positions[from];
+				const vec3 scaledBorderNormal = vec3::cross(edge, normal);
+				const float length = scaledBorderNormal.length();
+				if (length == 0.0f) continue;
+
+				const vec3 borderNormal = scaledBorderNormal / length;
+				const Quadric border = Quadric::fromPlane(borderNormal, -vec3::dot(borderNormal, mesh.positions[from]), vec3::dot(edge, edge) * borderWeight);
+				quadrics[mesh.remap[from]] += border;
+				quadrics[mesh.remap[to]] += border;
+			}
+		}
+	}
+
+	const double errorLimit = (double)maxError * maxError;
+	double largestError = 0.0;
+
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<bool> collapseLocked(vertexCount);
+
+	while (result.size() > targetIndexCount)
+	{
+		const EdgeAdjacency edges = buildEdges(result, vertexCount);
+		const Adjacency triangles = buildAdjacency(result, vertexCount);
+
+		//the twin's end of the seam edge, found by looking for the edge among the wedges of to
+		auto seamTwinTarget = [&](uint32_t from, uint32_t to)
+		{
+			const uint32_t twin = mesh.wedges[from];
+			uint32_t wedge = to;
+			do
+			{
+				if (edges.hasEdge(twin, wedge) || edges.hasEdge(wedge, twin)) return wedge;
+				wedge = mesh.wedges[wedge];
+			} while (wedge != to);
+			return noVertex;
+		};
+
+		auto attributeError = [&](uint32_t from, uint32_t to)
+		{
+			const vec3 edge = mesh.positions[to] - mesh.positions[from];
+			const vec3 colorChange = mesh.colors[to] - mesh.colors[from];
+			const float normalLengths = mesh.normals[from].length() * mesh.normals[to].length();
+			const double normalChange = normalLengths > 0.0f ? (1.0 - vec3::dot(mesh.normals[from], mesh.normals[to]) / normalLengths) * 0.5 : 0.0;
+			return vec3::dot(edge, edge) * attributeWeight * (normalChange + vec3::dot(colorChange, colorChange) / 3.0);
+		};
+
+		//what collapsing from onto to would cost, or a negative number if the vertex kinds don't allow it
+		auto collapseCost = [&](uint32_t from, uint32_t to, bool openEdge) -> double
+		{
+			const VertexKind fromKind = kinds[from];
+			const VertexKind toKind = kinds[to];
+			if (fromKind == VertexKind::locked) return -1.0;
+			if (fromKind == VertexKind::border && (!openEdge || (toKind != VertexKind::border && toKind != VertexKind::locked))) return -1.0;
+			if (fromKind == VertexKind::seam && (!openEdge || (toKind != VertexKind::seam && toKind != VertexKind::locked))) return -1.0;
+
+			double cost = quadrics[mesh.remap[from]].error(mesh.positions[to]) + attributeError(from, to);
+			if (fromKind == VertexKind::seam)
+			{
+				const uint32_t twinTarget = seamTwinTarget(from, to);
+				if (twinTarget == noVertex) return -1.0;
+				cost += attributeError(mesh.wedges[from], twinTarget);
+			}
+			return cost;
+		};
+
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			const uint32_t a = result[i];
+			const uint32_t b = result[i % 3 == 2 ? i - 2 : i + 1];
+			const bool openEdge = !edges.hasEdge(b, a);
+
+			//interior edges show up once per triangle, only take them from one side
+			if (!openEdge && a > b) continue;
+
+			const double aToB = collapseCost(a, b, openEdge);
+			const double bToA = collapseCost(b, a, openEdge);
+			if (aToB >= 0.0 && (bToA < 0.0 || aToB <= bToA)) collapses.push_back(Collapse{ .from = a, .to = b, .cost = aToB });
+			else if (bToA >= 0.0) collapses.push_back(Collapse{ .from = b, .to = a, .cost = bToA });
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+		//each collapse takes out two triangles, or one along a border, and touches each position at most once per pass
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+		std::fill(collapseLocked.begin(), collapseLocked.end(), false);
+		const size_t triangleGoal = (result.size() - targetIndexCount) / 3;
+		size_t trianglesRemoved = 0;
+		size_t collapseCount = 0;
+
+		for (const Collapse &collapse : collapses)
+		{
+			if (collapse.cost > errorLimit || trianglesRemoved >= triangleGoal) break;
+
+			const uint32_t fromPosition = mesh.remap[collapse.from];
+			const uint32_t toPosition = mesh.remap[collapse.to];
+			if (collapseLocked[fromPosition] || collapseLocked[toPosition]) continue;
+			if (flipsTriangles(result, triangles, mesh, collapse.from, collapse.to)) continue;
+
+			if (kinds[collapse.from] == VertexKind::seam)
+			{
+				const uint32_t twin = mesh.wedges[collapse.from];
+				const uint32_t twinTarget = seamTwinTarget(collapse.from, collapse.to);
+				if (flipsTriangles(result, triangles, mesh, twin, twinTarget)) continue;
+				collapseRemap[twin] = twinTarget;
+			}
+
+			collapseRemap[collapse.from] = collapse.to;
+			quadrics[toPosition] += quadrics[fromPosition];
+			collapseLocked[fromPosition] = collapseLocked[toPosition] = true;
+
+			trianglesRemoved += kinds[collapse.from] == VertexKind::border ? 1 : 2;
+			largestError = std::max(largestError, collapse.cost);
+			collapseCount++;
+		}
+
+		if (collapseCount == 0) break;
+
+		//move the collapsed corners and drop the triangles that lost an edge
+		size_t kept = 0;
+		for (size_t triangle = 0; triangle < result.size() / 3; triangle++)
+		{
+			const uint32_t a = collapseRemap[result[triangle * 3 + 0]];
+			const uint32_t b = collapseRemap[result[triangle * 3 + 1]];
+			const uint32_t c = collapseRemap[result[triangle * 3 + 2]];
+			if (mesh.remap[a] == mesh.remap[b] || mesh.remap[b] == mesh.remap[c] || mesh.remap[c] == mesh.remap[a]) continue;
+
+			result[kept++] = a;
+			result[kept++] = b;
+			result[kept++] = c;
+		}
+		result.resize(kept);
+	}
+
+	for (uint32_t &index : result) index = toGlobal[index];
+	return SimplifyResult
+	{
+		.indices = std::move(result),
+		.error = (float)std::sqrt(largestError)
+	};
+}
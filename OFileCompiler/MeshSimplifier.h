@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ObjVertex.h"
+
+struct SimplifyResult
+{
+	std::vector<uint32_t> indices;
+	float error = {}; //the largest deviation any collapse caused, in model units
+};
+
+//quadric error metric edge collapse (Garland and Heckbert 1997), removing vertices by moving them onto a neighbour so the vertex buffer is shared with the source
+//stops at targetIndexCount indices, or earlier once the cheapest collapse left would move the surface by more than maxError model units
+//attribute aware: UV and normal seams only collapse along themselves, open borders only along the border, and differing normals and colors add to a collapse's cost
+//vertices flagged in locked never move, e.g. the ones shared with another submesh, so there are no cracks between them
+[[nodiscard]]
+SimplifyResult simplify(const std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, const std::vector<bool> &locked, size_t targetIndexCount, float maxError);
@@ -0,0 +1,176 @@
+#include "MeshletBuilder.h"
+#include "MeshOptimiser.h"
+#include "MeshBounds.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	constexpr uint32_t notInMeshlet = UINT32_MAX;
+
+	//the normal cone comes from the triangles' own winding, not the vertex normals, since that's what backface culling goes by
+	void computeCone(OFile::Meshlet &meshlet, const std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices)
+	{
+		std::vector<vec3> normals;
+		normals.reserve(meshlet.triangleCount);
+		vec3 axis = {};
+		for (uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+		{
+			const uint32_t *corners = indices.data() + meshlet.firstIndex + triangle * 3;
+			const vec3 a = vertices[corners[0]].pos;
+			const vec3 normal = vec3::cross(vertices[corners[1]].pos - a, vertices[corners[2]].pos - a);
+			const float length = normal.length();
+			if (length == 0.0f) continue;
+
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+
+		//the cutoff of 1 can never be reached, so a meshlet that isn't cullable is never culled
+		meshlet.coneAxis = {};
+		meshlet.coneCutoff = 1.0f;
+		const float axisLength = axis.length();
+		if (axisLength == 0.0f) return;
+		axis /= axisLength;
+
+		float minimumDot = 1.0f;
+		for (const vec3 &normal : normals) minimumDot = std::min(minimumDot, vec3::dot(normal, axis));
+
+		//past ~85 degrees of spread the cone covers nearly every direction and culls next to nothing
+		if (minimumDot <= 0.1f) return;
+
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+	}
+}
+
+std::vector<OFile::Meshlet> buildMeshlets(std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, std::vector<OFile::Submesh> &submeshes,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	const size_t triangleCount = indices.size() / 3;
+	const Adjacency adjacency = buildAdjacency(indices, vertices.size());
+
+	std::vector<vec3> triangleNormals(triangleCount);
+	std::vector<vec3> triangleCentroids(triangleCount);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const vec3 a = vertices[indices[triangle * 3]].pos;
+		const vec3 b = vertices[indices[triangle * 3 + 1]].pos;
+		const vec3 c = vertices[indices[triangle * 3 + 2]].pos;
+		const vec3 normal = vec3::cross(b - a, c - a);
+		const float length = normal.length();
+		triangleNormals[triangle] = length > 0.0f ? normal / length : vec3{};
+		triangleCentroids[triangle] = (a + b + c) / 3.0f;
+	}
+
+	std::vector<OFile::Meshlet> meshlets;
+	meshlets.reserve(triangleCount / maxTriangles + submeshes.size());
+	std::vector<uint32_t> grouped;
+	grouped.reserve(indices.size());
+	std::vector<bool> emitted(triangleCount, false);
+
+	//which meshlet last used each vertex, so checking membership needs no clearing between meshlets
+	std::vector<uint32_t> lastMeshlet(vertices.size(), notInMeshlet);
+	std::vector<uint32_t> meshletVertices;
+	meshletVertices.reserve(maxVertices);
+	vec3 normalSum = {};
+	vec3 centroidSum = {};
+
+	auto newVerticesOf = [&](uint32_t triangle)
+	{
+		const uint32_t *corners = indices.data() + triangle * 3;
+		const uint32_t current = (uint32_t)meshlets.size() - 1;
+		uint32_t count = 0;
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			const bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+			if (!repeated && lastMeshlet[corners[corner]] != current) count++;
+		}
+		return count;
+	};
+
+	for (OFile::Submesh &submesh : submeshes)
+	{
+		submesh.firstMeshlet = (uint32_t)meshlets.size();
+		const uint32_t firstTriangle = submesh.firstIndex / 3;
+		const uint32_t endTriangle = firstTriangle + submesh.indexCount / 3;
+		uint32_t scanCursor = firstTriangle;
+
+		for (uint32_t placed = firstTriangle; placed < endTriangle; placed++)
+		{
+			const bool hasMeshlet = meshlets.size() > submesh.firstMeshlet;
+
+			//the neighbour of the current meshlet adding the fewest vertices, then the closest one with the most similar normal
+			uint32_t best = notInMeshlet;
+			uint32_t bestNewVertices = UINT32_MAX;
+			float bestScore = FLT_MAX;
+			const float normalLength = normalSum.length();
+			const vec3 averageNormal = normalLength > 0.0f ? normalSum / normalLength : vec3{};
+			const vec3 centroid = hasMeshlet ? centroidSum / (float)meshlets.back().triangleCount : vec3{};
+			for (size_t i = 0; hasMeshlet && i < meshletVertices.size(); i++)
+			{
+				const uint32_t vertex = meshletVertices[i];
+				for (uint32_t j = adjacency.offsets[vertex]; j < adjacency.offsets[vertex + 1]; j++)
+				{
+					const uint32_t triangle = adjacency.triangles[j];
+					if (triangle < firstTriangle || triangle >= endTriangle || emitted[triangle]) continue;
+
+					const uint32_t newVertices = newVerticesOf(triangle);
+					const float spread = 1.0f - vec3::dot(triangleNormals[triangle], averageNormal);
+					const float score = (triangleCentroids[triangle] - centroid).length() * (1.0f + spread);
+					if (newVertices < bestNewVertices || (newVertices == bestNewVertices && score < bestScore))
+					{
+						best = triangle;
+						bestNewVertices = newVertices;
+						bestScore = score;
+					}
+				}
+			}
+
+			//nothing connected left, carry on from the next triangle in the incoming order, which the cache optimisation left roughly spatially sorted
+			if (best == notInMeshlet)
+			{
+				while (emitted[scanCursor]) scanCursor++;
+				best = scanCursor;
+				bestNewVertices = hasMeshlet ? newVerticesOf(best) : 3;
+			}
+
+			if (!hasMeshlet || meshletVertices.size() + bestNewVertices > maxVertices || meshlets.back().triangleCount == maxTriangles)
+			{
+				meshlets.push_back(OFile::Meshlet{ .firstIndex = (uint32_t)grouped.size() });
+				meshletVertices.clear();
+				normalSum = {};
+				centroidSum = {};
+			}
+
+			const uint32_t meshlet = (uint32_t)meshlets.size() - 1;
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const uint32_t vertex = indices[best * 3 + corner];
+				grouped.push_back(vertex);
+				if (lastMeshlet[vertex] == meshlet) continue;
+				lastMeshlet[vertex] = meshlet;
+				meshletVertices.push_back(vertex);
+			}
+
+			normalSum += triangleNormals[best];
+			centroidSum += triangleCentroids[best];
+			emitted[best] = true;
+			meshlets.back().triangleCount++;
+		}
+
+		submesh.meshletCount = (uint32_t)meshlets.size() - submesh.firstMeshlet;
+	}
+
+	indices = std::move(grouped);
+	for (OFile::Meshlet &meshlet : meshlets)
+	{
+		const OFile::Bounds bounds = computeBounds(indices, meshlet.firstIndex, meshlet.triangleCount * 3, vertices);
+		meshlet.center = bounds.center;
+		meshlet.radius = bounds.radius;
+		computeCone(meshlet, indices, vertices);
+	}
+
+	return meshlets;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ObjVertex.h"
+#include "OFileSerialization.h"
+
+//what the mesh shader guidelines suggest, and small enough that a cluster covers a few square centimetres of a dense scan
+constexpr uint32_t maxMeshletVertices = 64;
+constexpr uint32_t maxMeshletTriangles = 124;
+
+//regroups every submesh's triangles into meshlets of at most maxVertices vertices and maxTriangles triangles, each a contiguous run of indices
+//a meshlet grows over the neighbouring triangle that adds the fewest vertices, ties going to the one closest to the meshlet's average normal so the normal cone stays narrow
+//fills in each submesh's meshlet range, meshlets never cross a submesh boundary
+[[nodiscard]]
+std::vector<OFile::Meshlet> buildMeshlets(std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, std::vector<OFile::Submesh> &submeshes,
+	uint32_t maxVertices = maxMeshletVertices, uint32_t maxTriangles = maxMeshletTriangles);
@@ -0,0 +1,528 @@
+#include "ObjParser.h"
+#pragma warning(push, 0)
+#include "tiny_obj_loader.h"
+#pragma warning(pop)
+#include "Logger/Logger.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "VertexWelder.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace
+{
+	//big enough that each chunk's bookkeeping is noise, small enough that even a modest file gives every thread a few
+	constexpr size_t parseChunkSize = 1 << 22;
+	constexpr uint32_t noIndex = UINT32_MAX;
+
+	//a line that changes which shape or material the triangles after it belong to, there are only a handful per file
+	struct ObjEvent
+	{
+		enum class Type : uint8_t
+		{
+			shape, //o or g, a new shape starts if the current one has any triangles
+			material, //usemtl
+			library //mtllib
+		};
+
+		Type type;
+		size_t triangle; //how many of the chunk's triangles come before it
+		std::string name;
+	};
+
+	//a face corner as the .obj wrote it, corners with the same indices are the same vertex without looking at the vertex
+	struct CornerKey
+	{
+		uint32_t position;
+		uint32_t uv;
+		uint32_t normal;
+
+		bool operator==(const CornerKey &other) const { return position == other.position && uv == other.uv && normal == other.normal; }
+	};
+
+	struct ObjChunk
+	{
+		const char *begin = nullptr;
+		const char *end = nullptr;
+
+		//filled in by the counting pass
+		size_t positionCount = 0;
+		size_t uvCount = 0;
+		size_t normalCount = 0;
+		size_t triangleCount = 0;
+		std::vector<ObjEvent> events;
+
+		//where the chunk's elements go, the sums of the counts of the chunks before it
+		size_t firstPosition = 0;
+		size_t firstUV = 0;
+		size_t firstNormal = 0;
+		size_t firstTriangle = 0;
+
+		//filled in by the parsing pass, the triangles' indices point into these until the chunks are welded together
+		std::vector<CornerKey> uniqueCorners;
+		size_t firstUniqueCorner = 0;
+		bool failed = false;
+	};
+
+	//every attribute of the file, indexed the way the faces index them
+	struct ObjAttributes
+	{
+		std::vector<vec3> positions;
+		std::vector<vec3> colors;
+		std::vector<vec2> uvs;
+		std::vector<vec3> normals;
+	};
+
+	class LineCursor
+	{
+	public:
+
+		LineCursor(const char *begin, const char *end) : at(begin), end(end) {}
+
+		[[nodiscard]]
+		bool atEnd()
+		{
+			skipSpaces();
+			return at >= end;
+		}
+
+		//the next whitespace separated word, empty at the end of the line
+		[[nodiscard]]
+		std::string_view word()
+		{
+			skipSpaces();
+			const char *begin = at;
+			while (at < end && !isSpace(*at)) at++;
+			return std::string_view(begin, at - begin);
+		}
+
+		//the next corner of an f line, empty at the end of the line or where a comment starts, even one touching the corner
+		[[nodiscard]]
+		std::string_view corner()
+		{
+			const std::string_view next = word();
+			const size_t comment = next.find('#');
+			if (comment == std::string_view::npos) return next;
+
+			at = end;
+			return next.substr(0, comment);
+		}
+
+		//everything left on the line without the whitespace around it, names may contain spaces
+		[[nodiscard]]
+		std::string rest()
+		{
+			skipSpaces();
+			const char *last = end;
+			while (last > at && isSpace(last[-1])) last--;
+			return std::string(at, last);
+		}
+
+		//parses like tinyobj does, as a double rounded to float, so both parsers agree on every bit
+		bool number(float &value)
+		{
+			skipSpaces();
+			if (at < end && *at == '+') at++;
+
+			double parsed = 0.0;
+			const std::from_chars_result result = std::from_chars(at, end, parsed);
+			if (result.ec != std::errc()) return false;
+
+			at = result.ptr;
+			value = (float)parsed;
+			return true;
+		}
+
+		bool integer(int64_t &value)
+		{
+			if (at < end && *at == '+') at++;
+			const std::from_chars_result result = std::from_chars(at, end, value);
+			if (result.ec != std::errc()) return false;
+
+			at = result.ptr;
+			return true;
+		}
+
+		bool skip(char character)
+		{
+			if (at >= end || *at != character) return false;
+			at++;
+			return true;
+		}
+
+	private:
+
+		static bool isSpace(char character) { return character == ' ' || character == '\t' || character == '\r'; }
+		void skipSpaces() { while (at < end && isSpace(*at)) at++; }
+
+		const char *at;
+		const char *end;
+	};
+
+	//calls function(keyword, cursor) for every line of the chunk that isn't empty or a comment
+	template<typename Function_t>
+	void forEachLine(const ObjChunk &chunk, Function_t &&function)
+	{
+		for (const char *line = chunk.begin; line < chunk.end;)
+		{
+			const char *lineEnd = (const char *)memchr(line, '\n', chunk.end - line);
+			if (lineEnd == nullptr) lineEnd = chunk.end;
+
+			LineCursor cursor(line, lineEnd);
+			const std::string_view keyword = cursor.word();
+			if (!keyword.empty() && keyword[0] != '#') function(keyword, cursor);
+
+			line = lineEnd + 1;
+		}
+	}
+
+	//cuts the text into chunks of roughly parseChunkSize, each ending just after a line break
+	std::vector<ObjChunk> splitIntoChunks(const char *text, size_t size)
+	{
+		std::vector<ObjChunk> chunks;
+		const char *end = text + size;
+		for (const char *begin = text; begin < end;)
+		{
+			const char *chunkEnd = begin + std::min(parseChunkSize, (size_t)(end - begin));
+			const char *lineBreak = chunkEnd < end ? (const char *)memchr(chunkEnd, '\n', end - chunkEnd) : nullptr;
+			chunkEnd = lineBreak != nullptr ? lineBreak + 1 : end;
+
+			chunks.push_back(ObjChunk{ .begin = begin, .end = chunkEnd });
+			begin = chunkEnd;
+		}
+		return chunks;
+	}
+
+	void countChunk(ObjChunk &chunk)
+	{
+		forEachLine(chunk, [&](std::string_view keyword, LineCursor &cursor)
+		{
+			if (keyword == "v") chunk.positionCount++;
+			else if (keyword == "vt") chunk.uvCount++;
+			else if (keyword == "vn") chunk.normalCount++;
+			else if (keyword == "f")
+			{
+				size_t cornerCount = 0;
+				while (!cursor.corner().empty()) cornerCount++;
+				if (cornerCount >= 3) chunk.triangleCount += cornerCount - 2;
+			}
+			else if (keyword == "o" || keyword == "g") chunk.events.push_back(ObjEvent{ .type = ObjEvent::Type::shape, .triangle = chunk.triangleCount });
+			else if (keyword == "usemtl") chunk.events.push_back(ObjEvent{ .type = ObjEvent::Type::material, .triangle = chunk.triangleCount, .name = cursor.rest() });
+			else if (keyword == "mtllib") chunk.events.push_back(ObjEvent{ .type = ObjEvent::Type::library, .triangle = chunk.triangleCount, .name = cursor.rest() });
+		});
+	}
+
+	//open addressing over the chunk's corners, so the welding of the whole file by bytes only sees each chunk's distinct ones
+	class CornerWelder
+	{
+	public:
+
+		explicit CornerWelder(size_t cornerCount) : slots(std::bit_ceil(std::max<size_t>(cornerCount * 2, 16)), noIndex), mask(slots.size() - 1) {}
+
+		[[nodiscard]]
+		uint32_t weld(const CornerKey &key, std::vector<CornerKey> &uniqueCorners)
+		{
+			uint64_t hash = (key.position * 0x9E3779B97F4A7C15ull) ^ (key.uv * 0xC2B2AE3D27D4EB4Full) ^ (key.normal * 0x165667B19E3779F9ull);
+			hash ^= hash >> 29;
+
+			for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+			{
+				if (slots[slot] == noIndex)
+				{
+					slots[slot] = (uint32_t)uniqueCorners.size();
+					uniqueCorners.push_back(key);
+					return slots[slot];
+				}
+				if (uniqueCorners[slots[slot]] == key) return slots[slot];
+			}
+		}
+
+	private:
+
+		std::vector<uint32_t> slots;
+		size_t mask;
+	};
+
+	//tinyobj's rules: 1 based, negative counts back from the elements so far, 0 is invalid
+	bool resolveIndex(int64_t index, size_t countSoFar, size_t total, uint32_t &resolved)
+	{
+		const int64_t zeroBased = index > 0 ? index - 1 : (int64_t)countSoFar + index;
+		if (index == 0 || zeroBased < 0 || zeroBased >= (int64_t)total) return false;
+
+		resolved = (uint32_t)zeroBased;
+		return true;
+	}
+
+	//parses the chunk's attributes into their place in attributes, and its faces into indices of its own distinct corners
+	void parseChunk(ObjChunk &chunk, ObjAttributes &attributes, uint32_t *indices)
+	{
+		size_t position = chunk.firstPosition;
+		size_t uv = chunk.firstUV;
+		size_t normal = chunk.firstNormal;
+		uint32_t *nextIndex = indices + chunk.firstTriangle * 3;
+
+		CornerWelder welder(chunk.triangleCount * 3);
+		std::vector<uint32_t> polygon;
+
+		auto parseCorner = [&](std::string_view word, CornerKey &key)
+		{
+			LineCursor cursor(word.data(), word.data() + word.size());
+			int64_t index = 0;
+			key = CornerKey{ .position = noIndex, .uv = noIndex, .normal = noIndex };
+			if (!cursor.integer(index) || !resolveIndex(index, position, attributes.positions.size(), key.position)) return false;
+			if (!cursor.skip('/')) return true;
+			if (cursor.integer(index) && !resolveIndex(index, uv, attributes.uvs.size(), key.uv)) return false;
+			if (!cursor.skip('/')) return true;
+			return !cursor.integer(index) || resolveIndex(index, normal, attributes.normals.size(), key.normal);
+		};
+
+		forEachLine(chunk, [&](std::string_view keyword, LineCursor &cursor)
+		{
+			if (chunk.failed) return;
+
+			if (keyword == "v")
+			{
+				vec3 &target = attributes.positions[position];
+				target = {};
+				for (size_t axis = 0; axis < 3; axis++) cursor.number(target[axis]);
+
+				vec3 color = {};
+				const bool hasColor = cursor.number(color[0]) && cursor.number(color[1]) && cursor.number(color[2]);
+				attributes.colors[position] = hasColor ? color : vec3(1.0f, 1.0f, 1.0f);
+				position++;
+			}
+			else if (keyword == "vt")
+			{
+				vec2 coordinates = {};
+				cursor.number(coordinates[0]);
+				cursor.number(coordinates[1]);
+				attributes.uvs[uv++] = vec2(coordinates.x(), 1.0f - coordinates.y());
+			}
+			else if (keyword == "vn")
+			{
+				vec3 &target = attributes.normals[normal++];
+				target = {};
+				for (size_t axis = 0; axis < 3; axis++) cursor.number(target[axis]);
+			}
+			else if (keyword == "f")
+			{
+				polygon.clear();
+				for (std::string_view word = cursor.corner(); !word.empty(); word = cursor.corner())
+				{
+					CornerKey key;
+					if (!parseCorner(word, key))
+					{
+						chunk.failed = true;
+						return;
+					}
+					polygon.push_back(welder.weld(key, chunk.uniqueCorners));
+				}
+
+				//fanned, which is what ear clipping gives for convex polygons too
+				for (size_t corner = 2; corner < polygon.size(); corner++)
+				{
+					*nextIndex++ = polygon[0];
+					*nextIndex++ = polygon[corner - 1];
+					*nextIndex++ = polygon[corner];
+				}
+			}
+		});
+	}
+
+	//.mtl files only matter here for the order their materials are declared in, which is what the material slots are
+	void loadMaterialLibrary(const std::filesystem::path &directory, const std::string &names, std::map<std::string, int> &materialIds, std::vector<tinyobj::material_t> &materials)
+	{
+		LineCursor cursor(names.data(), names.data() + names.size());
+		for (std::string_view name = cursor.word(); !name.empty(); name = cursor.word())
+		{
+			std::ifstream stream(directory / std::string(name));
+			if (!stream) continue;
+
+			std::string warn, err;
+			tinyobj::LoadMtl(&materialIds, &materials, &stream, &warn, &err);
+			if (!warn.empty()) Logger::logWarning(warn.c_str());
+			return;
+		}
+
+		Logger::logWarningFormatted("Couldn't load any material library of %s, using the default material", names.c_str());
+	}
+
+	//walks every chunk's events in file order, splitting the triangles into runs of one shape and one material
+	void buildRuns(const std::vector<ObjChunk> &chunks, const std::filesystem::path &directory, WeldedObj &result)
+	{
+		std::map<std::string, int> materialIds;
+		std::vector<tinyobj::material_t> materials;
+
+		uint32_t shape = 0;
+		uint32_t material = 0;
+		bool shapeHasTriangles = false;
+		size_t nextTriangle = 0;
+
+		auto addTrianglesUpTo = [&](size_t triangle)
+		{
+			if (triangle == nextTriangle) return;
+
+			if (result.runs.empty() || result.runs.back().shape != shape || result.runs.back().material != material)
+			{
+				result.runs.push_back(ObjFaceRun{ .firstIndex = (uint32_t)(nextTriangle * 3), .shape = shape, .material = material });
+			}
+			shapeHasTriangles = true;
+			nextTriangle = triangle;
+		};
+
+		for (const ObjChunk &chunk : chunks)
+		{
+			for (const ObjEvent &event : chunk.events)
+			{
+				addTrianglesUpTo(chunk.firstTriangle + event.triangle);
+
+				if (event.type == ObjEvent::Type::shape && shapeHasTriangles)
+				{
+					shape++;
+					shapeHasTriangles = false;
+				}
+				else if (event.type == ObjEvent::Type::material)
+				{
+					const auto found = materialIds.find(event.name);
+					material = found != materialIds.end() ? (uint32_t)std::max(found->second, 0) : 0u;
+				}
+				else if (event.type == ObjEvent::Type::library)
+				{
+					loadMaterialLibrary(directory, event.name, materialIds, materials);
+				}
+			}
+		}
+
+		addTrianglesUpTo(result.indices.size() / 3);
+		result.shapeCount = shape + (shapeHasTriangles ? 1 : 0);
+	}
+}
+
+std::optional<WeldedObj> parseObj(const std::string &path, ThreadPool *pool, ObjParseStatistics *statistics)
+{
+	std::optional<MappedFile> file = MappedFile::open(path.c_str());
+	if (!file.has_value())
+	{
+		Logger::logErrorFormatted("Couldn't open %s", path.c_str());
+		return std::nullopt;
+	}
+
+	auto forEachChunk = [&](std::vector<ObjChunk> &chunks, auto &&function)
+	{
+		if (pool != nullptr) pool->parallelFor(chunks.size(), [&](size_t chunk) { function(chunks[chunk]); });
+		else for (ObjChunk &chunk : chunks) function(chunk);
+	};
+
+	std::vector<ObjChunk> chunks = splitIntoChunks((const char *)file->data(), file->size());
+	forEachChunk(chunks, countChunk);
+
+	ObjChunk totals;
+	for (ObjChunk &chunk : chunks)
+	{
+		chunk.firstPosition = totals.positionCount;
+		chunk.firstUV = totals.uvCount;
+		chunk.firstNormal = totals.normalCount;
+		chunk.firstTriangle = totals.triangleCount;
+
+		totals.positionCount += chunk.positionCount;
+		totals.uvCount += chunk.uvCount;
+		totals.normalCount += chunk.normalCount;
+		totals.triangleCount += chunk.triangleCount;
+	}
+
+	//like tinyobj, any vertex without a color gets white rather than the whole file losing its colors
+	WeldedObj result
+	{
+		.indices = std::vector<uint32_t>(totals.triangleCount * 3),
+		.hasUV = totals.uvCount > 0,
+		.hasNormals = totals.normalCount > 0,
+		.hasColors = totals.positionCount > 0
+	};
+
+	ObjAttributes attributes
+	{
+		.positions = std::vector<vec3>(totals.positionCount),
+		.colors = std::vector<vec3>(totals.positionCount),
+		.uvs = std::vector<vec2>(totals.uvCount),
+		.normals = std::vector<vec3>(totals.normalCount)
+	};
+
+	forEachChunk(chunks, [&](ObjChunk &chunk) { parseChunk(chunk, attributes, result.indices.data()); });
+
+	for (size_t chunk = 0; chunk < chunks.size(); chunk++)
+	{
+		if (!chunks[chunk].failed) continue;
+		Logger::logErrorFormatted("%s has a face with an invalid index in chunk %zu", path.c_str(), chunk);
+		return std::nullopt;
+	}
+
+	size_t uniqueCornerCount = 0;
+	for (ObjChunk &chunk : chunks)
+	{
+		chunk.firstUniqueCorner = uniqueCornerCount;
+		uniqueCornerCount += chunk.uniqueCorners.size();
+	}
+
+	const size_t attributeBytes = attributes.positions.size() * sizeof(vec3) * 2 + attributes.uvs.size() * sizeof(vec2) + attributes.normals.size() * sizeof(vec3);
+	const size_t cornerKeyBytes = uniqueCornerCount * sizeof(CornerKey);
+	const size_t indexBytes = result.indices.size() * sizeof(uint32_t);
+
+	//the distinct corners of every chunk, in file order, so welding them by bytes numbers the vertices by first use like welding every corner would
+	std::vector<ObjVertex> chunkVertices(uniqueCornerCount);
+	forEachChunk(chunks, [&](ObjChunk &chunk)
+	{
+		for (size_t i = 0; i < chunk.uniqueCorners.size(); i++)
+		{
+			const CornerKey &key = chunk.uniqueCorners[i];
+			chunkVertices[chunk.firstUniqueCorner + i] = ObjVertex
+			{
+				.pos = attributes.positions[key.position],
+				.uv = key.uv != noIndex ? attributes.uvs[key.uv] : vec2(),
+				.normal = key.normal != noIndex ? attributes.normals[key.normal] : vec3(),
+				.color = attributes.colors[key.position]
+			};
+		}
+		chunk.uniqueCorners = {};
+	});
+	attributes = {};
+
+	WeldResult welded;
+	if (pool != nullptr && chunkVertices.size() >= parallelWeldThreshold)
+	{
+		welded = weldParallel(chunkVertices, *pool);
+	}
+	else
+	{
+		VertexWelder welder(chunkVertices.size());
+		welded.indices.reserve(chunkVertices.size());
+		for (const ObjVertex &vertex : chunkVertices) welded.indices.push_back(welder.weld(vertex));
+		welded.vertices = welder.takeVertices();
+	}
+	const size_t weldBytes = chunkVertices.size() * (sizeof(ObjVertex) + sizeof(uint32_t)) + welded.vertices.size() * sizeof(ObjVertex);
+	chunkVertices = {};
+
+	forEachChunk(chunks, [&](ObjChunk &chunk)
+	{
+		uint32_t *indices = result.indices.data() + chunk.firstTriangle * 3;
+		for (size_t i = 0; i < chunk.triangleCount * 3; i++) indices[i] = welded.indices[chunk.firstUniqueCorner + indices[i]];
+	});
+
+	result.vertices = std::move(welded.vertices);
+	buildRuns(chunks, std::filesystem::path(path).parent_path(), result);
+
+	if (statistics != nullptr)
+	{
+		*statistics = ObjParseStatistics
+		{
+			.chunkCount = chunks.size(),
+			.peakBytes = indexBytes + std::max(attributeBytes + cornerKeyBytes + uniqueCornerCount * sizeof(ObjVertex), weldBytes)
+		};
+	}
+
+	return result;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <optional>
+#include <string>
+#include "ObjProcessing.h"
+
+class ThreadPool;
+
+//the most parseObj holds at once besides the mapped file, which the OS pages in and out as it likes
+struct ObjParseStatistics
+{
+	size_t chunkCount = {};
+	size_t peakBytes = {};
+};
+
+//parses the .obj at path straight into welded vertices, without a copy of the text or a vertex per corner ever existing
+//the file is mapped and cut into chunks at line breaks, which are parsed in parallel across the pool when one is given:
+//a first pass counts what every chunk holds, so the second knows where its attributes and triangles go and can weld its corners by their v/vt/vn indices on its own
+//the chunks' vertices are then welded together by their bytes, which gives the same vertices and indices as loadObj and weldObj
+//the only difference is that polygons are fanned rather than ear clipped, which only comes out differently for concave ones
+[[nodiscard]]
+std::optional<WeldedObj> parseObj(const std::string &path, ThreadPool *pool = nullptr, ObjParseStatistics *statistics = nullptr);
@@ -0,0 +1,533 @@
+#include "ObjProcessing.h"
+#pragma warning(push, 0)
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+#pragma warning(pop)
+#include "Logger/Logger.h"
+#include "Quantisation.h"
+#include "Serializer.h"
+#include "ThreadPool.h"
+#include "VertexWelder.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "MeshBounds.h"
+#include "TangentSpace.h"
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#pragma warning(disable : 26451)
+
+namespace
+{
+	constexpr size_t cornerBlockSize = 1 << 16;
+
+	//attributes the .obj or the corner doesn't have are left zeroed, so they never make two corners differ
+	ObjVertex makeVertex(const ObjAttribute &attrib, const tinyobj::index_t &index)
+	{
+		ObjVertex vertex
+		{
+			.pos
+			{
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2]
+			}
+		};
+
+		if (index.texcoord_index >= 0)
+		{
+			vertex.uv = {
+					attrib.texcoords[2 * index.texcoord_index + 0],
+					1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+			};
+		}
+
+		if (index.normal_index >= 0)
+		{
+			vertex.normal = {
+					attrib.normals[3 * index.normal_index + 0],
+					attrib.normals[3 * index.normal_index + 1],
+					attrib.normals[3 * index.normal_index + 2]
+			};
+		}
+
+		if (!attrib.colors.empty())
+		{
+			vertex.color = {
+					attrib.colors[3 * index.vertex_index + 0],
+					attrib.colors[3 * index.vertex_index + 1],
+					attrib.colors[3 * index.vertex_index + 2]
+			};
+		}
+
+		return vertex;
+	}
+
+	//reorders the welded triangles so every (shape, material) pair is contiguous, shapes stay in file order
+	//returns one submesh per pair, without bounds since the vertices still move after this
+	std::vector<OFile::Submesh> groupSubmeshes(const std::vector<ObjFaceRun> &runs, std::vector<uint32_t> &indices)
+	{
+		std::vector<OFile::Submesh> submeshes;
+		std::vector<uint32_t> grouped;
+		grouped.reserve(indices.size());
+		std::vector<uint32_t> runOrder;
+
+		auto runEnd = [&](size_t run) { return run + 1 < runs.size() ? runs[run + 1].firstIndex : (uint32_t)indices.size(); };
+
+		for (size_t shapeBegin = 0, shapeEnd = 0; shapeBegin < runs.size(); shapeBegin = shapeEnd)
+		{
+			for (shapeEnd = shapeBegin + 1; shapeEnd < runs.size() && runs[shapeEnd].shape == runs[shapeBegin].shape; shapeEnd++);
+
+			runOrder.resize(shapeEnd - shapeBegin);
+			std::iota(runOrder.begin(), runOrder.end(), (uint32_t)shapeBegin);
+			std::stable_sort(runOrder.begin(), runOrder.end(), [&](uint32_t a, uint32_t b) { return runs[a].material < runs[b].material; });
+
+			for (size_t i = 0; i < runOrder.size(); i++)
+			{
+				const ObjFaceRun &run = runs[runOrder[i]];
+				if (i == 0 || submeshes.back().materialSlot != run.material)
+				{
+					submeshes.push_back(OFile::Submesh{ .firstIndex = (uint32_t)grouped.size(), .materialSlot = run.material });
+				}
+
+				grouped.insert(grouped.end(), indices.begin() + run.firstIndex, indices.begin() + runEnd(runOrder[i]));
+				submeshes.back().indexCount += runEnd(runOrder[i]) - run.firstIndex;
+			}
+		}
+
+		if (submeshes.empty()) submeshes.push_back(OFile::Submesh{});
+		indices = std::move(grouped);
+		return submeshes;
+	}
+
+	struct IndexRange
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	//runs the cache pass, and the overdraw pass if asked to, on each range on its own so triangles never move between ranges
+	//every range is moved into a vertex space of its own first, which keeps the cost proportional to the range rather than the whole mesh
+	void optimiseRanges(std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, const std::vector<IndexRange> &ranges, bool sortForOverdraw)
+	{
+		constexpr uint32_t unmapped = UINT32_MAX;
+		std::vector<uint32_t> toLocal(vertices.size(), unmapped);
+		std::vector<uint32_t> toGlobal;
+		std::vector<ObjVertex> localVertices;
+		std::vector<uint32_t> localIndices;
+		std::vector<uint32_t> clusterStarts;
+
+		for (const IndexRange &range : ranges)
+		{
+			toGlobal.clear();
+			localVertices.clear();
+			localIndices.resize(range.count);
+			clusterStarts.clear();
+
+			for (uint32_t i = 0; i < range.count; i++)
+			{
+				const uint32_t index = indices[range.first + i];
+				if (toLocal[index] == unmapped)
+				{
+					toLocal[index] = (uint32_t)toGlobal.size();
+					toGlobal.push_back(index);
+					localVertices.push_back(vertices[index]);
+				}
+				localIndices[i] = toLocal[index];
+			}
+
+			optimiseVertexCache(localIndices, localVertices.size(), defaultVertexCacheSize, &clusterStarts);
+			if (sortForOverdraw) optimiseOverdraw(localIndices, localVertices, clusterStarts);
+
+			for (uint32_t i = 0; i < range.count; i++) indices[range.first + i] = toGlobal[localIndices[i]];
+			for (const uint32_t index : toGlobal) toLocal[index] = unmapped;
+		}
+	}
+
+	//flags the vertices whose position is used by more than one submesh, simplifying those would open cracks between the submeshes
+	std::vector<bool> lockSharedPositions(const std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, const std::vector<OFile::Submesh> &submeshes)
+	{
+		std::vector<bool> locked(vertices.size(), false);
+		if (submeshes.size() < 2) return locked;
+
+		constexpr uint32_t unused = UINT32_MAX;
+		constexpr uint32_t shared = UINT32_MAX - 1;
+		std::vector<uint32_t> owners(vertices.size(), unused);
+		for (uint32_t submesh = 0; submesh < submeshes.size(); submesh++)
+		{
+			for (uint32_t i = submeshes[submesh].firstIndex; i < submeshes[submesh].firstIndex + submeshes[submesh].indexCount; i++)
+			{
+				uint32_t &owner = owners[indices[i]];
+				owner = owner == unused || owner == submesh ? submesh : shared;
+			}
+		}
+
+		//the welder made equal positions bit identical, so vertices that differ only in attributes can be grouped by sorting
+		std::vector<uint32_t> byPosition(vertices.size());
+		std::iota(byPosition.begin(), byPosition.end(), 0);
+		auto comparePositions = [&](uint32_t a, uint32_t b) { return memcmp(&vertices[a].pos, &vertices[b].pos, sizeof(vec3)); };
+		std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) { return comparePositions(a, b) < 0; });
+
+		for (size_t begin = 0, end = 0; begin < byPosition.size(); begin = end)
+		{
+			uint32_t owner = unused;
+			for (end = begin; end < byPosition.size() && comparePositions(byPosition[begin], byPosition[end]) == 0; end++)
+			{
+				const uint32_t vertexOwner = owners[byPosition[end]];
+				if (vertexOwner == unused) continue;
+				owner = owner == unused || owner == vertexOwner ? vertexOwner : shared;
+			}
+
+			if (owner != shared) continue;
+			for (size_t i = begin; i < end; i++) locked[byPosition[i]] = true;
+		}
+
+		return locked;
+	}
+
+	//simplifies every submesh into a chain of levels, each from the one before, and appends their indices after the full detail ones
+	std::vector<OFile::Lod> buildLods(std::vector<uint32_t> &indices, const std::vector<ObjVertex> &vertices, std::vector<OFile::Submesh> &submeshes, const OFile::Bounds &meshBounds, const CompileOptions &options)
+	{
+		std::vector<OFile::Lod> lods;
+		if (options.lodCount == 0 || vertices.empty()) return lods;
+
+		const float meshRadius = (meshBounds.maximum - meshBounds.minimum).length() * 0.5f;
+
+		const std::vector<bool> locked = lockSharedPositions(indices, vertices, submeshes);
+		std::vector<uint32_t> previous;
+
+		for (OFile::Submesh &submesh : submeshes)
+		{
+			submesh.firstLod = (uint32_t)lods.size();
+			previous.assign(indices.begin() + submesh.firstIndex, indices.begin() + submesh.firstIndex + submesh.indexCount);
+			float previousError = 0.0f;
+
+			for (uint32_t level = 0; level < options.lodCount; level++)
+			{
+				const size_t targetIndexCount = previous.size() / 6 * 3;
+				const float maxError = options.lodError * (float)(1u << level) * meshRadius;
+				SimplifyResult simplified = simplify(previous, vertices, locked, targetIndexCount, maxError);
+
+				//a level barely smaller than the last isn't worth its memory, and the ones after it would stall the same way
+				if (simplified.indices.empty() || simplified.indices.size() * 10 > previous.size() * 9) break;
+
+				const OFile::Lod lod
+				{
+					.firstIndex = (uint32_t)indices.size(),
+					.indexCount = (uint32_t)simplified.indices.size(),
+					.error = previousError + simplified.error
+				};
+				indices.insert(indices.end(), simplified.indices.begin(), simplified.indices.end());
+				lods.push_back(lod);
+				submesh.lodCount++;
+
+				previous = std::move(simplified.indices);
+				previousError = lod.error;
+			}
+		}
+
+		return lods;
+	}
+}
+
+bool loadObj(const std::string &path, ObjAttribute &attrib, std::vector<ObjShape> &shapes)
+{
+	std::vector<tinyobj::material_t> materials;
+	std::string warn, err;
+
+	//.mtl files are looked up next to the .obj rather than in the working directory
+	const std::string materialDirectory = std::filesystem::path(path).parent_path().string();
+	tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), materialDirectory.empty() ? nullptr : materialDirectory.c_str());
+	if (!warn.empty()) Logger::logWarning(warn.c_str());
+	if (!err.empty())
+	{
+		Logger::logError(err.c_str());
+		return false;
+	}
+	return true;
+}
+
+std::vector<ObjVertex> gatherCorners(const ObjAttribute &attrib, const std::vector<ObjShape> &shapes, ThreadPool *pool)
+{
+	size_t cornerCount = 0;
+	for (const auto &shape : shapes) cornerCount += shape.mesh.indices.size();
+
+	std::vector<ObjVertex> corners(cornerCount);
+	size_t shapeBegin = 0;
+	for (const auto &shape : shapes)
+	{
+		const std::vector<tinyobj::index_t> &shapeIndices = shape.mesh.indices;
+		auto gatherBlock = [&](size_t block)
+		{
+			const size_t end = std::min(shapeIndices.size(), (block + 1) * cornerBlockSize);
+			for (size_t i = block * cornerBlockSize; i < end; i++) corners[shapeBegin + i] = makeVertex(attrib, shapeIndices[i]);
+		};
+
+		const size_t blockCount = (shapeIndices.size() + cornerBlockSize - 1) / cornerBlockSize;
+		if (pool != nullptr) pool->parallelFor(blockCount, gatherBlock);
+		else for (size_t block = 0; block < blockCount; block++) gatherBlock(block);
+
+		shapeBegin += shapeIndices.size();
+	}
+
+	return corners;
+}
+
+WeldedObj weldObj(const ObjAttribute &attrib, const std::vector<ObjShape> &shapes, ThreadPool *pool)
+{
+	WeldedObj result
+	{
+		.shapeCount = (uint32_t)shapes.size(),
+		.hasUV = attrib.texcoords.size() > 0,
+		.hasNormals = attrib.normals.size() > 0,
+		.hasColors = attrib.colors.size() > 0
+	};
+
+	size_t cornerCount = 0;
+	for (const auto &shape : shapes) cornerCount += shape.mesh.indices.size();
+
+	if (pool != nullptr && cornerCount >= parallelWeldThreshold)
+	{
+		WeldResult welded = weldParallel(gatherCorners(attrib, shapes, pool), *pool);
+		result.vertices = std::move(welded.vertices);
+		result.indices = std::move(welded.indices);
+	}
+	else
+	{
+		//most meshes share each vertex between several corners, the welder grows if this guess is short
+		VertexWelder welder(cornerCount / 4);
+		result.indices.reserve(cornerCount);
+		for (const auto &shape : shapes)
+			for (const auto &index : shape.mesh.indices)
+				result.indices.push_back(welder.weld(makeVertex(attrib, index)));
+
+		result.vertices = welder.takeVertices();
+	}
+
+	uint32_t indexBegin = 0;
+	for (uint32_t shape = 0; shape < shapes.size(); shape++)
+	{
+		const std::vector<int> &materialIds = shapes[shape].mesh.material_ids;
+		for (size_t triangle = 0; triangle < shapes[shape].mesh.indices.size() / 3; triangle++)
+		{
+			const uint32_t material = triangle < materialIds.size() ? (uint32_t)std::max(materialIds[triangle], 0) : 0u;
+			if (result.runs.empty() || result.runs.back().shape != shape || result.runs.back().material != material)
+			{
+				result.runs.push_back(ObjFaceRun{ .firstIndex = indexBegin, .shape = shape, .material = material });
+			}
+			indexBegin += 3;
+		}
+	}
+
+	return result;
+}
+
+OFile::FileData processObj(WeldedObj &&obj, const CompileOptions &options, OptimisationReport *report)
+{
+	const bool hasUV = obj.hasUV;
+	const bool hasColors = obj.hasColors;
+
+	Logger::logMessageFormatted(
+		"This model %s UVs",
+		(hasUV) ? "has" : "doesn't have"
+	);
+
+	Logger::logMessageFormatted(
+		"This model %s per-vertex colors",
+		(hasColors) ? "has" : "doesn't have"
+	);
+
+	Logger::logMessageFormatted(
+		"This model %s per-vertex normals",
+		(obj.hasNormals) ? "has" : "doesn't have"
+	);
+
+	std::vector<ObjVertex> vertices = std::move(obj.vertices);
+	std::vector<uint32_t> indices = std::move(obj.indices);
+
+	//both only remap indices and add or merge vertices, so the runs' index ranges stay as they are
+	const bool generatesNormals = options.recomputeNormals || (options.generateNormals && !obj.hasNormals);
+	if (generatesNormals)
+	{
+		const size_t vertexCount = vertices.size();
+		generateNormals(indices, vertices);
+		Logger::logMessageFormatted("Generated smooth normals, %zu vertices welded into %zu", vertexCount, vertices.size());
+	}
+
+	const bool hasNormals = obj.hasNormals || generatesNormals;
+	const bool hasTangents = options.generateTangents && hasUV && hasNormals;
+	if (hasTangents)
+	{
+		const size_t vertexCount = vertices.size();
+		generateTangents(indices, vertices);
+		Logger::logMessageFormatted("Generated tangents, %zu vertices split where mirrored UVs meet", vertices.size() - vertexCount);
+	}
+	else if (options.generateTangents)
+	{
+		Logger::logMessage("Tangents need UVs and normals, this model is left without them");
+	}
+
+	std::vector<AttributeType> attributes
+	{
+		options.quantisePositions ? AttributeType::unorm16x4 : AttributeType::vec3
+	};
+
+	if (hasUV)			attributes.push_back(options.compactAttributes ? AttributeType::half2 : AttributeType::vec2);
+	if (hasNormals)		attributes.push_back(options.compactAttributes ? AttributeType::octahedral16 : AttributeType::vec3);
+	if (hasColors)		attributes.push_back(options.compactAttributes ? AttributeType::unorm8x4 : AttributeType::vec3);
+	if (hasTangents)	attributes.push_back(options.compactAttributes ? AttributeType::snorm8x4 : AttributeType::vec4);
+
+	std::vector<OFile::Submesh> submeshes = groupSubmeshes(obj.runs, indices);
+	//the triangles move around from here on but the vertices they use don't, and every vertex is used by some triangle
+	const OFile::Bounds meshBounds = computeBounds(indices, 0, indices.size(), vertices);
+
+	OptimisationReport optimisation{ .before = simulateVertexCache(indices, vertices.size()) };
+	if (options.optimise)
+	{
+		std::vector<IndexRange> submeshRanges;
+		for (const OFile::Submesh &submesh : submeshes) submeshRanges.push_back(IndexRange{ .first = submesh.firstIndex, .count = submesh.indexCount });
+		optimiseRanges(indices, vertices, submeshRanges, true);
+	}
+
+	//building meshlets regroups the triangles, which is why they get their own cache pass and the vertex fetch order comes last
+	//without them the submeshes keep the order their own cache pass gave them
+	std::vector<OFile::Meshlet> meshlets;
+	if (options.meshlets)
+	{
+		meshlets = buildMeshlets(indices, vertices, submeshes);
+		const size_t cullableMeshlets = std::count_if(meshlets.begin(), meshlets.end(), [](const OFile::Meshlet &meshlet) { return meshlet.coneCutoff < 1.0f; });
+		Logger::logMessageFormatted(
+			"%zu meshlets of %.1f triangles on average, %zu of them narrow enough for cone culling",
+			meshlets.size(),
+			meshlets.empty() ? 0.0f : (float)(indices.size() / 3) / meshlets.size(),
+			cullableMeshlets
+		);
+	}
+
+	if (options.optimise)
+	{
+		if (options.meshlets)
+		{
+			std::vector<IndexRange> meshletRanges;
+			for (const OFile::Meshlet &meshlet : meshlets) meshletRanges.push_back(IndexRange{ .first = meshlet.firstIndex, .count = meshlet.triangleCount * 3 });
+			optimiseRanges(indices, vertices, meshletRanges, false);
+		}
+		optimisation.after = simulateVertexCache(indices, vertices.size());
+
+		Logger::logMessageFormatted(
+			"Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+			optimisation.before.acmr, optimisation.after.acmr,
+			optimisation.before.atvr, optimisation.after.atvr
+		);
+	}
+	else
+	{
+		optimisation.after = simulateVertexCache(indices, vertices.size());
+	}
+	if (report != nullptr) *report = optimisation;
+
+	//the levels share the vertices, so the fetch order is only settled once their indices are in too
+	std::vector<OFile::Lod> lods = buildLods(indices, vertices, submeshes, meshBounds, options);
+	for (const OFile::Submesh &submesh : submeshes)
+	{
+		for (uint32_t level = 0; level < submesh.lodCount; level++)
+		{
+			const OFile::Lod &lod = lods[submesh.firstLod + level];
+			Logger::logMessageFormatted("Submesh %td LOD %u: %u triangles, error %g", &submesh - submeshes.data(), level + 1, lod.indexCount / 3, lod.error);
+		}
+	}
+
+	if (options.optimise)
+	{
+		std::vector<IndexRange> lodRanges;
+		for (const OFile::Lod &lod : lods) lodRanges.push_back(IndexRange{ .first = lod.firstIndex, .count = lod.indexCount });
+		optimiseRanges(indices, vertices, lodRanges, false);
+		optimiseVertexFetch(indices, vertices);
+	}
+
+	for (OFile::Submesh &submesh : submeshes) submesh.bounds = computeBounds(indices, submesh.firstIndex, submesh.indexCount, vertices);
+
+	Logger::logMessageFormatted("%zu submeshes across %u shapes", submeshes.size(), obj.shapeCount);
+
+	OFile::FileData result
+	{
+		.header
+		{
+			.attributes = std::move(attributes),
+			.vertexLayout = options.splitPositions ? OFile::VertexLayout::splitPositions : OFile::VertexLayout::interleaved,
+			.vertexAmount = vertices.size(),
+			.bounds = meshBounds,
+			.submeshes = std::move(submeshes),
+			.meshlets = std::move(meshlets),
+			.lods = std::move(lods)
+		}
+	};
+	OFile::setIndices(result, indices);
+
+	if (options.quantisePositions)
+	{
+		result.header.positionOffset = meshBounds.minimum;
+		result.header.positionScale = meshBounds.maximum - meshBounds.minimum;
+		for (size_t i = 0; i < 3; i++)
+		{
+			if (result.header.positionScale[i] == 0.0f) result.header.positionScale[i] = 1.0f; //flat along this axis, anything but 0 will do
+		}
+	}
+
+	std::vector<std::byte> vertexData = std::vector<std::byte>(vertices.size() * sizeof(ObjVertex));
+	StreamOut stream(vertexData.data(), vertexData.size());
+	auto writePosition = [&](const ObjVertex &vertex)
+	{
+		if (options.quantisePositions) stream.setNext(quantise::toUnorm16x4(vertex.pos, result.header.positionOffset, result.header.positionScale));
+		else stream.setNext(vertex.pos);
+	};
+
+	if (options.splitPositions)
+	{
+		for (const ObjVertex &vertex : vertices) writePosition(vertex);
+	}
+
+	for (auto &vertex : vertices)
+	{
+		if (!options.splitPositions) writePosition(vertex);
+
+		if (hasUV)
+		{
+			if (options.compactAttributes) stream.setNext(quantise::toHalf2(vertex.uv));
+			else stream.setNext(vertex.uv);
+		}
+
+		if (hasNormals)
+		{
+			if (options.compactAttributes) stream.setNext(quantise::toOctahedral16(vertex.normal));
+			else stream.setNext(vertex.normal);
+		}
+
+		if (hasColors)
+		{
+			if (options.compactAttributes) stream.setNext(quantise::toUnorm8x4(vertex.color));
+			else stream.setNext(vertex.color);
+		}
+
+		if (hasTangents)
+		{
+			if (options.compactAttributes) stream.setNext(quantise::toSnorm8x4(vertex.tangent));
+			else stream.setNext(vertex.tangent);
+		}
+	}
+
+	result.vertices = std::move(vertexData);
+	result.vertices.resize(stream.bytesWritten());
+
+	const size_t kbWritten = result.vertices.size() / 1024;
+
+	Logger::logMessageFormatted(
+		"%zu individual vertices found, which take %zu KB at %zu bytes each.",
+		vertices.size(),
+		kbWritten,
+		vertices.empty() ? 0 : result.vertices.size() / vertices.size()
+	);
+
+	return result;
+}
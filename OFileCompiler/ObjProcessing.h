@@ -0,0 +1,50 @@
+#pragma once
+#pragma warning(push, 0)
+#include "tiny_obj_loader.h"
+#pragma warning(pop)
+#include <string>
+#include <vector>
+#include "OFileSerialization.h"
+#include "CompileOptions.h"
+#include "MeshOptimiser.h"
+#include "ObjVertex.h"
+
+class ThreadPool;
+
+using ObjAttribute = tinyobj::attrib_t;
+using ObjShape = tinyobj::shape_t;
+
+//a run of triangles from one shape of the .obj, all using one material
+struct ObjFaceRun
+{
+	uint32_t firstIndex = {};
+	uint32_t shape = {};
+	uint32_t material = {}; //the index of the material in the .mtl files, 0 when it has none or an unknown one
+};
+
+//a whole .obj welded into one triangle list, what processObj works from whichever parser read it
+struct WeldedObj
+{
+	std::vector<ObjVertex> vertices = {};
+	std::vector<uint32_t> indices = {};
+	std::vector<ObjFaceRun> runs = {}; //in index order, a new one starts wherever the shape or material changes
+	uint32_t shapeCount = {};
+	bool hasUV = {};
+	bool hasNormals = {};
+	bool hasColors = {};
+};
+
+[[nodiscard]]
+bool loadObj(const std::string &path, ObjAttribute &attrib, std::vector<ObjShape> &shapes);
+
+//one vertex per face corner, in shape order, before any welding
+[[nodiscard]]
+std::vector<ObjVertex> gatherCorners(const ObjAttribute &attrib, const std::vector<ObjShape> &shapes, ThreadPool *pool = nullptr);
+
+//welds the corners tinyobj loaded, big meshes are welded across the pool when one is given
+[[nodiscard]]
+WeldedObj weldObj(const ObjAttribute &attrib, const std::vector<ObjShape> &shapes, ThreadPool *pool = nullptr);
+
+//fills in normals and tangents and optimises the triangle and vertex order and cuts the triangles into meshlets if asked to, simplifies each submesh into LODs, then packs the attributes the .obj has
+[[nodiscard]]
+OFile::FileData processObj(WeldedObj &&obj, const CompileOptions &options, OptimisationReport *report = nullptr);
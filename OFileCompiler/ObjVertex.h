@@ -0,0 +1,29 @@
+#pragma once
+#include "vec.h"
+
+struct ObjVertex
+{
+	vec3 pos = {};
+	vec2 uv = {};
+	vec3 normal = {};
+	vec3 color = {};
+	vec4 tangent = {}; //only filled in by generateTangents, after welding
+
+	bool operator==(const ObjVertex &other) const {
+		return pos == other.pos && uv == other.uv && normal == other.normal && color == other.color && tangent == other.tangent;
+	}
+};
+
+namespace std {
+	template<> struct hash<ObjVertex> {
+		size_t operator()(const ObjVertex &vertex) const {
+			const auto posUvHash = (hash<vec3>()(vertex.pos) << 1)
+				^ (hash<vec2>()(vertex.uv));
+
+			const auto normalColorHash = (hash<vec3>()(vertex.normal) >> 1)
+				^ (hash<vec3>()(vertex.color));
+
+			return posUvHash ^ normalColorHash;
+		}
+	};
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "vec.h"
+
+//encoders for the compact AttributeTypes, the GPU decodes them through the vertex input formats
+
+namespace quantise
+{
+	//round to nearest even, overflows go to infinity and values too small for a half flush to zero
+	[[nodiscard]]
+	inline uint16_t toHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const uint32_t absolute = bits & 0x7FFFFFFF;
+
+		if (absolute >= 0x7F800000) return (uint16_t)(sign | 0x7C00 | (absolute > 0x7F800000 ? 0x200 : 0)); //inf and nan
+		if (absolute >= 0x477FF000) return (uint16_t)(sign | 0x7C00); //rounds past the largest half
+		if (absolute < 0x33000001) return (uint16_t)sign;
+
+		if (absolute < 0x38800000)
+		{
+			//denormal half: shift the mantissa, implicit bit included, into place
+			const uint32_t shift = 126 - (absolute >> 23);
+			const uint32_t mantissa = (absolute & 0x007FFFFF) | 0x00800000;
+			const uint32_t halfMantissa = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			const uint32_t rounded = halfMantissa + (remainder > halfway || (remainder == halfway && (halfMantissa & 1)));
+			return (uint16_t)(sign | rounded);
+		}
+
+		const uint32_t rebiased = absolute - 0x38000000;
+		const uint32_t rounded = rebiased + 0x0FFF + ((rebiased >> 13) & 1);
+		return (uint16_t)(sign | (rounded >> 13));
+	}
+
+	[[nodiscard]]
+	inline std::array<uint16_t, 2> toHalf2(const vec2 &value)
+	{
+		return { toHalf(value.x()), toHalf(value.y()) };
+	}
+
+	[[nodiscard]]
+	inline int16_t toSnorm16(float value)
+	{
+		const float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+		return (int16_t)std::lround(clamped * 32767.0f);
+	}
+
+	[[nodiscard]]
+	inline int8_t toSnorm8(float value)
+	{
+		const float clamped = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+		return (int8_t)std::lround(clamped * 127.0f);
+	}
+
+	[[nodiscard]]
+	inline uint16_t toUnorm16(float value)
+	{
+		const float clamped = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+		return (uint16_t)std::lround(clamped * 65535.0f);
+	}
+
+	[[nodiscard]]
+	inline uint8_t toUnorm8(float value)
+	{
+		const float clamped = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+		return (uint8_t)std::lround(clamped * 255.0f);
+	}
+
+	//projects the unit vector onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one
+	//see "A Survey of Efficient Representations for Independent Unit Vectors", Cigolle et al. 2014
+	[[nodiscard]]
+	inline std::array<int16_t, 2> toOctahedral16(const vec3 &normal)
+	{
+		const float manhattanLength = fabsf(normal.x()) + fabsf(normal.y()) + fabsf(normal.z());
+		if (manhattanLength == 0.0f) return { 0, 0 };
+
+		float x = normal.x() / manhattanLength;
+		float y = normal.y() / manhattanLength;
+		if (normal.z() < 0.0f)
+		{
+			const float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			const float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		return { toSnorm16(x), toSnorm16(y) };
+	}
+
+	[[nodiscard]]
+	inline std::array<uint8_t, 4> toUnorm8x4(const vec3 &color)
+	{
+		return { toUnorm8(color.x()), toUnorm8(color.y()), toUnorm8(color.z()), 255 };
+	}
+
+	[[nodiscard]]
+	inline std::array<int8_t, 4> toSnorm8x4(const vec4 &tangent)
+	{
+		return { toSnorm8(tangent.x()), toSnorm8(tangent.y()), toSnorm8(tangent.z()), toSnorm8(tangent.w()) };
+	}
+
+	//position relative to the bounds described by offset and scale, scale components must not be 0
+	[[nodiscard]]
+	inline std::array<uint16_t, 4> toUnorm16x4(const vec3 &position, const vec3 &offset, const vec3 &scale)
+	{
+		const vec3 normalised = (position - offset) / scale;
+		return { toUnorm16(normalised.x()), toUnorm16(normalised.y()), toUnorm16(normalised.z()), 0 };
+	}
+}
@@ -0,0 +1,151 @@
+#include "TangentSpace.h"
+#include "VertexWelder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+	constexpr uint32_t noVertex = UINT32_MAX;
+
+	//any unit vector perpendicular to normal, for vertices whose UVs give no direction
+	vec3 perpendicular(const vec3 &normal)
+	{
+		const vec3 axis = fabsf(normal.x()) < 0.9f ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f);
+		const vec3 tangent = vec3::cross(normal, axis);
+		const float length = tangent.length();
+		return length > 0.0f ? tangent / length : vec3(1.0f, 0.0f, 0.0f);
+	}
+
+	//Gram-Schmidt against the normal, which the .obj may not have normalised
+	vec4 finishTangent(const vec3 &objNormal, const vec3 &sum, float sign)
+	{
+		const float normalLength = objNormal.length();
+		const vec3 normal = normalLength > 0.0f ? objNormal / normalLength : objNormal;
+		vec3 tangent = sum - normal * vec3::dot(normal, sum);
+		const float length = tangent.length();
+		tangent = length > 1e-6f ? tangent / length : perpendicular(normal);
+		return vec4(tangent.x(), tangent.y(), tangent.z(), sign);
+	}
+
+	float cornerAngle(const vec3 &corner, const vec3 &next, const vec3 &previous)
+	{
+		const vec3 a = next - corner;
+		const vec3 b = previous - corner;
+		const float lengths = a.length() * b.length();
+		return lengths > 0.0f ? acosf(std::clamp(vec3::dot(a, b) / lengths, -1.0f, 1.0f)) : 0.0f;
+	}
+}
+
+void generateNormals(std::vector<uint32_t> &indices, std::vector<ObjVertex> &vertices)
+{
+	//the welder made equal positions bit identical, so sorting finds the first vertex at every position
+	std::vector<uint32_t> byPosition(vertices.size());
+	std::iota(byPosition.begin(), byPosition.end(), 0);
+	auto comparePositions = [&](uint32_t a, uint32_t b) { return memcmp(&vertices[a].pos, &vertices[b].pos, sizeof(vec3)); };
+	std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) { return comparePositions(a, b) < 0; });
+
+	std::vector<uint32_t> group(vertices.size());
+	for (size_t begin = 0, end = 0; begin < byPosition.size(); begin = end)
+	{
+		for (end = begin; end < byPosition.size() && comparePositions(byPosition[begin], byPosition[end]) == 0; end++) group[byPosition[end]] = byPosition[begin];
+	}
+
+	std::vector<vec3> sums(vertices.size(), vec3(0.0f, 0.0f, 0.0f));
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const vec3 &a = vertices[indices[i + 0]].pos;
+		const vec3 faceNormal = vec3::cross(vertices[indices[i + 1]].pos - a, vertices[indices[i + 2]].pos - a);
+		for (size_t corner = 0; corner < 3; corner++) sums[group[indices[i + corner]]] += faceNormal;
+	}
+
+	for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+	{
+		const vec3 &sum = sums[group[vertex]];
+		const float length = sum.length();
+		//only degenerate or perfectly cancelling triangles get here, any unit vector beats a zero one
+		vertices[vertex].normal = length > 0.0f ? sum / length : vec3(0.0f, 1.0f, 0.0f);
+	}
+
+	VertexWelder welder(vertices.size());
+	std::vector<uint32_t> remap(vertices.size());
+	for (size_t vertex = 0; vertex < vertices.size(); vertex++) remap[vertex] = welder.weld(vertices[vertex]);
+	if (welder.vertices().size() == vertices.size()) return;
+
+	for (uint32_t &index : indices) index = remap[index];
+	vertices = welder.takeVertices();
+}
+
+void generateTangents(std::vector<uint32_t> &indices, std::vector<ObjVertex> &vertices)
+{
+	const size_t vertexCount = vertices.size();
+	const size_t triangleCount = indices.size() / 3;
+
+	//a sum per vertex for each sign of the bitangent, [vertex * 2 + 1] is the mirrored one
+	std::vector<vec3> sums(vertexCount * 2, vec3(0.0f, 0.0f, 0.0f));
+	std::vector<uint8_t> signsUsed(vertexCount, 0);
+	std::vector<int8_t> triangleSigns(triangleCount, 0);
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const uint32_t *corners = &indices[triangle * 3];
+		const ObjVertex &v0 = vertices[corners[0]];
+		const ObjVertex &v1 = vertices[corners[1]];
+		const ObjVertex &v2 = vertices[corners[2]];
+
+		const vec3 edge1 = v1.pos - v0.pos;
+		const vec3 edge2 = v2.pos - v0.pos;
+		const vec2 deltaUV1 = v1.uv - v0.uv;
+		const vec2 deltaUV2 = v2.uv - v0.uv;
+
+		const float determinant = deltaUV1.x() * deltaUV2.y() - deltaUV2.x() * deltaUV1.y();
+		if (determinant == 0.0f || !std::isfinite(determinant)) continue; //no UV gradient, the vertex gets one from its other triangles or a made up one
+
+		const vec3 tangent = (edge1 * deltaUV2.y() - edge2 * deltaUV1.y()) / determinant;
+		const vec3 bitangent = (edge2 * deltaUV1.x() - edge1 * deltaUV2.x()) / determinant;
+		const float tangentLength = tangent.length();
+		if (tangentLength == 0.0f || !std::isfinite(tangentLength)) continue;
+
+		const vec3 faceNormal = vec3::cross(edge1, edge2);
+		const int8_t sign = vec3::dot(vec3::cross(faceNormal, tangent), bitangent) < 0.0f ? -1 : 1;
+		triangleSigns[triangle] = sign;
+
+		const size_t side = sign < 0 ? 1 : 0;
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			const float angle = cornerAngle(vertices[corners[corner]].pos, vertices[corners[(corner + 1) % 3]].pos, vertices[corners[(corner + 2) % 3]].pos);
+			sums[corners[corner] * 2 + side] += tangent * (angle / tangentLength);
+			signsUsed[corners[corner]] |= 1 << side;
+		}
+	}
+
+	std::vector<uint32_t> mirrored(vertexCount, noVertex);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		if (signsUsed[vertex] != 3) continue;
+		mirrored[vertex] = (uint32_t)vertices.size();
+		vertices.push_back(vertices[vertex]);
+	}
+
+	if (vertices.size() > vertexCount)
+	{
+		for (size_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			if (triangleSigns[triangle] >= 0) continue;
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t &index = indices[triangle * 3 + corner];
+				if (mirrored[index] != noVertex) index = mirrored[index];
+			}
+		}
+	}
+
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const vec3 &normal = vertices[vertex].normal;
+		const size_t side = signsUsed[vertex] == 2 ? 1 : 0;
+		vertices[vertex].tangent = finishTangent(normal, sums[vertex * 2 + side], side == 1 ? -1.0f : 1.0f);
+		if (mirrored[vertex] != noVertex) vertices[mirrored[vertex]].tangent = finishTangent(normal, sums[vertex * 2 + 1], -1.0f);
+	}
+}
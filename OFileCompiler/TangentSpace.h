@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ObjVertex.h"
+
+//area weighted smooth normals: each triangle adds its face normal, whose length is twice its area, to every vertex at its corners' positions
+//summing across all the vertices at a position keeps UV seams out of the lighting, hard edges are smoothed over too
+//vertices that end up the same, e.g. ones that only differed in the normals being replaced, are welded and indices remapped
+void generateNormals(std::vector<uint32_t> &indices, std::vector<ObjVertex> &vertices);
+
+//per vertex tangents after MikkTSpace (Mikkelsen 2008): each triangle's UV gradient, angle weighted and projected onto the vertex normal
+//the bitangent's sign goes in tangent.w, the shader rebuilds it as cross(normal, tangent) * w
+//vertices where mirrored UVs meet are split in two, so each side keeps its own sign rather than averaging to nothing
+//needs UVs and normals
+void generateTangents(std::vector<uint32_t> &indices, std::vector<ObjVertex> &vertices);
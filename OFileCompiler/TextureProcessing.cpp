@@ -0,0 +1,218 @@
+#include "TextureProcessing.h"
+#pragma warning(push, 0)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#pragma warning(pop)
+#include "BlockCompression.h"
+#include "Logger/Logger.h"
+#include "ThreadPool.h"
+#include "vec.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#pragma warning(disable : 26451)
+
+namespace
+{
+	struct FloatLevel
+	{
+		uint32_t width = {};
+		uint32_t height = {};
+		std::vector<vec4> pixels = {};
+	};
+
+	template<typename Function_t>
+	void forEachRow(uint32_t rowCount, ThreadPool *pool, Function_t &&function)
+	{
+		if (pool != nullptr) pool->parallelFor(rowCount, [&](size_t row) { function((uint32_t)row); });
+		else for (uint32_t row = 0; row < rowCount; row++) function(row);
+	}
+
+	float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint8_t toByte(float value)
+	{
+		return (uint8_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+	}
+
+	FloatLevel toFloat(const Rgba8Image &image, bool srgb)
+	{
+		std::array<float, 256> toLinear;
+		for (size_t value = 0; value < 256; value++) toLinear[value] = srgb ? srgbToLinear(value / 255.0f) : value / 255.0f;
+
+		FloatLevel level{ .width = image.width, .height = image.height, .pixels = std::vector<vec4>((size_t)image.width * image.height) };
+		for (size_t pixel = 0; pixel < level.pixels.size(); pixel++)
+		{
+			const uint8_t *bytes = &image.pixels[pixel * 4];
+			level.pixels[pixel] = vec4(toLinear[bytes[0]], toLinear[bytes[1]], toLinear[bytes[2]], bytes[3] / 255.0f);
+		}
+		return level;
+	}
+
+	std::vector<uint8_t> toRgba8(const FloatLevel &level, bool srgb)
+	{
+		std::vector<uint8_t> bytes(level.pixels.size() * 4);
+		for (size_t pixel = 0; pixel < level.pixels.size(); pixel++)
+		{
+			const vec4 &color = level.pixels[pixel];
+			for (size_t channel = 0; channel < 3; channel++) bytes[pixel * 4 + channel] = toByte(srgb ? linearToSrgb(color[channel]) : color[channel]);
+			bytes[pixel * 4 + 3] = toByte(color.w());
+		}
+		return bytes;
+	}
+
+	//each texel of the next level averages the 2x2 texels under it, odd sized levels drop their last row or column
+	FloatLevel downsample(const FloatLevel &level, bool normalMap, ThreadPool *pool)
+	{
+		FloatLevel next{ .width = std::max(1u, level.width / 2), .height = std::max(1u, level.height / 2) };
+		next.pixels.resize((size_t)next.width * next.height);
+
+		forEachRow(next.height, pool, [&](uint32_t y)
+		{
+			const uint32_t rows[2] = { std::min(y * 2, level.height - 1), std::min(y * 2 + 1, level.height - 1) };
+			for (uint32_t x = 0; x < next.width; x++)
+			{
+				const uint32_t columns[2] = { std::min(x * 2, level.width - 1), std::min(x * 2 + 1, level.width - 1) };
+
+				vec3 sum = vec3(0.0f, 0.0f, 0.0f);
+				vec3 alphaWeightedSum = vec3(0.0f, 0.0f, 0.0f);
+				float alphaSum = 0.0f;
+				for (const uint32_t row : rows)
+				{
+					for (const uint32_t column : columns)
+					{
+						const vec4 &texel = level.pixels[(size_t)row * level.width + column];
+						const vec3 color = normalMap ? vec3(texel.x() * 2.0f - 1.0f, texel.y() * 2.0f - 1.0f, texel.z() * 2.0f - 1.0f) : vec3(texel.x(), texel.y(), texel.z());
+						sum += color;
+						alphaWeightedSum += color * texel.w();
+						alphaSum += texel.w();
+					}
+				}
+
+				vec3 color;
+				if (normalMap)
+				{
+					const float length = sum.length();
+					color = (length > 0.0f ? sum / length : vec3(0.0f, 0.0f, 1.0f)) * 0.5f + 0.5f;
+				}
+				else
+				{
+					color = alphaSum > 0.0f ? alphaWeightedSum / alphaSum : sum / 4.0f;
+				}
+				next.pixels[(size_t)y * next.width + x] = vec4(color.x(), color.y(), color.z(), alphaSum / 4.0f);
+			}
+		});
+
+		return next;
+	}
+
+	//blocks hanging over the edge of small levels repeat the edge texels
+	void encodeLevel(const std::vector<uint8_t> &bytes, uint32_t width, uint32_t height, TextureFormat format, std::byte *destination, ThreadPool *pool)
+	{
+		if (!isBlockCompressed(format))
+		{
+			memcpy(destination, bytes.data(), bytes.size());
+			return;
+		}
+
+		const uint32_t blocksWide = (width + 3) / 4;
+		const uint32_t blocksHigh = (height + 3) / 4;
+		const size_t blockSize = textureFormatToBlockSize(format);
+		forEachRow(blocksHigh, pool, [&](uint32_t blockY)
+		{
+			PixelBlock pixels;
+			for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+			{
+				for (uint32_t y = 0; y < 4; y++)
+				{
+					const size_t row = std::min(blockY * 4 + y, height - 1);
+					for (uint32_t x = 0; x < 4; x++)
+					{
+						const size_t column = std::min(blockX * 4 + x, width - 1);
+						memcpy(&pixels[(y * 4 + x) * 4], &bytes[(row * width + column) * 4], 4);
+					}
+				}
+				encodeBlock(format, pixels, destination + ((size_t)blockY * blocksWide + blockX) * blockSize);
+			}
+		});
+	}
+}
+
+std::optional<Rgba8Image> loadImage(const std::string &path)
+{
+	int width, height, channels;
+	stbi_uc *pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (pixels == nullptr)
+	{
+		return std::nullopt;
+	}
+
+	Rgba8Image image{ .width = (uint32_t)width, .height = (uint32_t)height };
+	image.pixels.assign(pixels, pixels + (size_t)width * height * 4);
+	stbi_image_free(pixels);
+	return image;
+}
+
+TextureFile::FileData processImage(const Rgba8Image &image, const CompileOptions &options, ThreadPool *pool)
+{
+	const TextureFormat format = options.textureFormat;
+	const bool normalMap = format == TextureFormat::bc5;
+	const bool srgb = options.srgbTextures && !normalMap;
+
+	TextureFile::FileData result
+	{
+		.header
+		{
+			.format = format,
+			.srgb = srgb,
+			.width = image.width,
+			.height = image.height
+		}
+	};
+
+	//a full chain, the same sizes Vulkan expects: every level halves and rounds down, until both sides are 1
+	const uint32_t levelCount = std::bit_width(std::max(image.width, image.height));
+	size_t payloadBytes = 0;
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		const uint32_t width = std::max(1u, image.width >> level);
+		const uint32_t height = std::max(1u, image.height >> level);
+		const size_t size = textureLevelBytes(format, width, height);
+		result.header.levels.push_back(TextureFile::Level{ .offset = payloadBytes, .size = size, .width = width, .height = height });
+		payloadBytes += size;
+	}
+	result.payload.resize(payloadBytes);
+
+	FloatLevel level = toFloat(image, srgb);
+	for (const TextureFile::Level &levelLayout : result.header.levels)
+	{
+		if (levelLayout.width != level.width || levelLayout.height != level.height) level = downsample(level, normalMap, pool);
+
+		//the full size level goes in as it was loaded, rather than through a round trip to floats
+		const std::vector<uint8_t> bytes = &levelLayout == &result.header.levels.front() ? image.pixels : toRgba8(level, srgb);
+		encodeLevel(bytes, levelLayout.width, levelLayout.height, format, result.payload.data() + levelLayout.offset, pool);
+	}
+
+	const size_t uncompressedBytes = (size_t)image.width * image.height * 4;
+	Logger::logMessageFormatted(
+		"%ux%u texture with %u mip levels takes %zu KB, its first level %zu KB instead of %zu KB as rgba8",
+		image.width,
+		image.height,
+		levelCount,
+		payloadBytes / 1024,
+		result.header.levels.front().size / 1024,
+		uncompressedBytes / 1024
+	);
+
+	return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "CompileOptions.h"
+#include "TextureSerialization.h"
+
+class ThreadPool;
+
+struct Rgba8Image
+{
+	uint32_t width = {};
+	uint32_t height = {};
+	std::vector<uint8_t> pixels = {}; //row by row, 4 bytes each
+};
+
+//anything stb_image reads, expanded to rgba8
+[[nodiscard]]
+std::optional<Rgba8Image> loadImage(const std::string &path);
+
+//box filters the full mip chain down to 1x1 and encodes every level in options.textureFormat
+//colors are filtered in linear space and weighted by their alpha, so transparent texels don't bleed into the mips; bc5 textures are filtered as normals
+//rows are filtered and blocks encoded across the pool when one is given
+[[nodiscard]]
+TextureFile::FileData processImage(const Rgba8Image &image, const CompileOptions &options, ThreadPool *pool = nullptr);
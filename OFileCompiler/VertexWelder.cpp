@@ -0,0 +1,201 @@
+#include "VertexWelder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace
+{
+	constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t prime3 = 0x165667B19E3779F9ull;
+	constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+
+	//corners are hashed, counted and scattered in blocks of this size
+	constexpr size_t cornerBlockSize = 1 << 16;
+
+	bool sameBytes(const ObjVertex &a, const ObjVertex &b)
+	{
+		return memcmp(&a, &b, sizeof(ObjVertex)) == 0;
+	}
+
+	//returns the slot holding a match, or the empty slot where the vertex belongs
+	template<typename Matches_t>
+	VertexWelder::Slot &probe(std::vector<VertexWelder::Slot> &slots, size_t mask, uint64_t hash, Matches_t &&matches)
+	{
+		const uint32_t tag = (uint32_t)(hash >> 32);
+		for (size_t position = hash & mask;; position = (position + 1) & mask)
+		{
+			VertexWelder::Slot &slot = slots[position];
+			if (slot.index == VertexWelder::emptySlot || (slot.tag == tag && matches(slot.index))) return slot;
+		}
+	}
+}
+
+VertexWelder::VertexWelder(size_t expectedVertices)
+{
+	rehash(std::bit_ceil(std::max<size_t>(64, expectedVertices * 2)));
+	uniqueVertices.reserve(expectedVertices);
+}
+
+uint32_t VertexWelder::weld(const ObjVertex &vertex)
+{
+	//keep the load factor under 1/2 so probe sequences stay short
+	if ((uniqueVertices.size() + 1) * 2 > slots.size()) rehash(slots.size() * 2);
+
+	const uint64_t hash = hashVertex(vertex);
+	Slot &slot = probe(slots, mask, hash, [&](uint32_t index) { return sameBytes(uniqueVertices[index], vertex); });
+	if (slot.index == emptySlot)
+	{
+		slot = Slot{ .tag = (uint32_t)(hash >> 32), .index = (uint32_t)uniqueVertices.size() };
+		uniqueVertices.push_back(vertex);
+	}
+
+	return slot.index;
+}
+
+uint64_t VertexWelder::hashVertex(const ObjVertex &vertex)
+{
+	static_assert(sizeof(ObjVertex) == 15 * sizeof(float), "ObjVertex is hashed as 15 tightly packed floats");
+
+	uint64_t words[(sizeof(ObjVertex) + 7) / 8] = {};
+	memcpy(words, &vertex, sizeof(ObjVertex));
+
+	//xxhash64 style rounds and avalanche, inlined for the fixed size
+	uint64_t hash = prime4 + sizeof(ObjVertex);
+	for (const uint64_t word : words)
+	{
+		hash ^= std::rotl(word * prime2, 31) * prime1;
+		hash = std::rotl(hash, 27) * prime1 + prime4;
+	}
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+void VertexWelder::rehash(size_t slotCount)
+{
+	slots.assign(slotCount, Slot{});
+	mask = slotCount - 1;
+
+	for (uint32_t i = 0; i < (uint32_t)uniqueVertices.size(); i++)
+	{
+		const uint64_t hash = hashVertex(uniqueVertices[i]);
+		probe(slots, mask, hash, [](uint32_t) { return false; }) = Slot{ .tag = (uint32_t)(hash >> 32), .index = i };
+	}
+}
+
+WeldResult weldParallel(const std::vector<ObjVertex> &corners, ThreadPool &pool)
+{
+	const size_t cornerCount = corners.size();
+	const size_t blockCount = (cornerCount + cornerBlockSize - 1) / cornerBlockSize;
+	const size_t shardCount = std::bit_ceil(std::max<size_t>(2, (pool.workerCount() + 1) * 4));
+	const int shardShift = 64 - std::countr_zero(shardCount);
+
+	auto forEachBlock = [&](auto &&function)
+	{
+		pool.parallelFor(blockCount, [&](size_t block)
+		{
+			const size_t end = std::min(cornerCount, (block + 1) * cornerBlockSize);
+			function(block, block * cornerBlockSize, end);
+		});
+	};
+
+	std::vector<uint64_t> hashes(cornerCount);
+	std::vector<uint32_t> blockShardCounts(blockCount * shardCount, 0);
+	forEachBlock([&](size_t block, size_t begin, size_t end)
+	{
+		uint32_t *counts = blockShardCounts.data() + block * shardCount;
+		for (size_t i = begin; i < end; i++)
+		{
+			hashes[i] = VertexWelder::hashVertex(corners[i]);
+			counts[hashes[i] >> shardShift]++;
+		}
+	});
+
+	//bucket the corners by shard, keeping them in their original order inside each shard
+	std::vector<size_t> shardBegins(shardCount + 1, 0);
+	std::vector<uint32_t> blockShardOffsets(blockCount * shardCount);
+	for (size_t shard = 0, offset = 0; shard < shardCount; shard++)
+	{
+		shardBegins[shard] = offset;
+		for (size_t block = 0; block < blockCount; block++)
+		{
+			blockShardOffsets[block * shardCount + shard] = (uint32_t)offset;
+			offset += blockShardCounts[block * shardCount + shard];
+		}
+	}
+	shardBegins[shardCount] = cornerCount;
+
+	std::vector<uint32_t> cornersByShard(cornerCount);
+	forEachBlock([&](size_t block, size_t begin, size_t end)
+	{
+		uint32_t *offsets = blockShardOffsets.data() + block * shardCount;
+		for (size_t i = begin; i < end; i++) cornersByShard[offsets[hashes[i] >> shardShift]++] = (uint32_t)i;
+	});
+
+	//every corner learns the first corner with the same bytes, shards never share a vertex so they don't need to talk
+	std::vector<uint32_t> firstCorners(cornerCount);
+	pool.parallelFor(shardCount, [&](size_t shard)
+	{
+		const size_t begin = shardBegins[shard];
+		const size_t end = shardBegins[shard + 1];
+		if (begin == end) return;
+
+		std::vector<VertexWelder::Slot> slots(std::bit_ceil((end - begin) * 2));
+		const size_t mask = slots.size() - 1;
+		for (size_t i = begin; i < end; i++)
+		{
+			const uint32_t corner = cornersByShard[i];
+			const uint64_t hash = hashes[corner];
+			VertexWelder::Slot &slot = probe(slots, mask, hash, [&](uint32_t other) { return sameBytes(corners[other], corners[corner]); });
+			if (slot.index == VertexWelder::emptySlot) slot = VertexWelder::Slot{ .tag = (uint32_t)(hash >> 32), .index = corner };
+			firstCorners[corner] = slot.index;
+		}
+	});
+
+	hashes = {};
+	cornersByShard = {};
+
+	//number the unique vertices by first use, which is the order the serial welder produces
+	std::vector<uint32_t> blockUniqueOffsets(blockCount + 1, 0);
+	forEachBlock([&](size_t block, size_t begin, size_t end)
+	{
+		uint32_t uniqueCount = 0;
+		for (size_t i = begin; i < end; i++) uniqueCount += firstCorners[i] == i;
+		blockUniqueOffsets[block + 1] = uniqueCount;
+	});
+	for (size_t block = 0; block < blockCount; block++) blockUniqueOffsets[block + 1] += blockUniqueOffsets[block];
+
+	WeldResult result
+	{
+		.vertices = std::vector<ObjVertex>(blockUniqueOffsets[blockCount]),
+		.indices = std::vector<uint32_t>(cornerCount)
+	};
+
+	forEachBlock([&](size_t block, size_t begin, size_t end)
+	{
+		uint32_t next = blockUniqueOffsets[block];
+		for (size_t i = begin; i < end; i++)
+		{
+			if (firstCorners[i] != i) continue;
+			result.vertices[next] = corners[i];
+			result.indices[i] = next++;
+		}
+	});
+
+	forEachBlock([&](size_t, size_t begin, size_t end)
+	{
+		//first corners are only read here, other blocks may be reading them at the same time
+		for (size_t i = begin; i < end; i++)
+		{
+			if (firstCorners[i] != i) result.indices[i] = result.indices[firstCorners[i]];
+		}
+	});
+
+	return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ObjVertex.h"
+
+class ThreadPool;
+
+//deduplicates vertices by their exact bytes, indices are handed out in first-use order
+//flat open addressing with linear probing: each slot keeps 32 bits of the hash next to the index, so a probe only touches the vertex on a likely match
+class VertexWelder
+{
+public:
+
+	explicit VertexWelder(size_t expectedVertices = 0);
+
+	//returns the index of vertex, adding it if it's the first time it's seen
+	[[nodiscard]]
+	uint32_t weld(const ObjVertex &vertex);
+
+	[[nodiscard]]
+	const std::vector<ObjVertex> &vertices() const { return uniqueVertices; }
+
+	[[nodiscard]]
+	std::vector<ObjVertex> takeVertices() { return std::move(uniqueVertices); }
+
+	[[nodiscard]]
+	static uint64_t hashVertex(const ObjVertex &vertex);
+
+	static constexpr uint32_t emptySlot = UINT32_MAX;
+
+	struct Slot
+	{
+		uint32_t tag = 0;
+		uint32_t index = emptySlot;
+	};
+
+private:
+
+	void rehash(size_t slotCount);
+
+	std::vector<Slot> slots;
+	std::vector<ObjVertex> uniqueVertices;
+	size_t mask = 0;
+};
+
+struct WeldResult
+{
+	std::vector<ObjVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//below this many corners the serial welder wins, spinning up the shards costs more than it saves
+constexpr size_t parallelWeldThreshold = 1 << 18;
+
+//welds every corner and gives the same result as feeding them to a VertexWelder in order
+//hashing is split across the pool, then each worker welds the corners of its own hash shards
+[[nodiscard]]
+WeldResult weldParallel(const std::vector<ObjVertex> &corners, ThreadPool &pool);
@@ -1,189 +1,16 @@
-#include "Files.h"
 #include "Logger/Logger.h"
-#include <unordered_map>
+#include "AssetBuild.h"
+#include "AssetCache.h"
+#include "BatchCompiler.h"
+#include "Benchmarks.h"
+#include "Compiler.h"
+#include "ThreadPool.h"
 #include <algorithm>
-#pragma warning(push, 0)
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-#pragma warning(pop)
-#include <optional>
+#include <chrono>
+#include <filesystem>
+#include <string>
 #pragma warning(disable : 26451)
 #define RETURNCHECK(expr, errmsg) if(!(expr)) { Logger::logError(errmsg); return -1; }
-#include "OFileSerialization.h"
-#include <iostream>
-#include "Serializer.h"
-#include "vec.h"
-
-using ObjAttribute = tinyobj::attrib_t;
-using ObjShape = tinyobj::shape_t;
-
-
-struct ObjVertex
-{
-	vec3 pos = {};
-	vec2 uv = {};
-	vec3 normal = {};
-	vec3 color = {};
-
-	bool operator==(const ObjVertex &other) const {
-		return pos == other.pos && uv == other.uv && normal == other.normal && color == other.color;
-	}
-};
-
-namespace std {
-	template<> struct hash<ObjVertex> {
-		size_t operator()(const ObjVertex &vertex) const {
-			const auto posUvHash = (hash<vec3>()(vertex.pos) << 1)
-				^ (hash<vec2>()(vertex.uv));
-
-			const auto normalColorHash = (hash<vec3>()(vertex.normal) >> 1)
-				^ (hash<vec3>()(vertex.color));
-
-			return posUvHash ^ normalColorHash;
-		}
-	};
-}
-
-[[nodiscard]]
-bool loadObj(const std::string &path, ObjAttribute &attrib, std::vector<ObjShape> &shapes)
-{
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
-
-	tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str());
-	if (!warn.empty()) Logger::logWarning(warn.c_str());
-	if (!err.empty())
-	{
-		Logger::logError(err.c_str());
-		return false;
-	}
-	return true;
-}
-
-[[nodiscard]]
-OFile::FileData processObj(const ObjAttribute &attrib, const std::vector<ObjShape> &shapes)
-{
-	const bool hasUV = attrib.texcoords.size() > 0;
-	const bool hasNormals = attrib.normals.size() > 0;
-	const bool hasColors = attrib.colors.size() > 0;
-
-	Logger::logMessageFormatted(
-		"This model %s UVs",
-		(hasUV) ? "has" : "doesn't have"
-	);
-
-	Logger::logMessageFormatted(
-		"This model %s per-vertex colors",
-		(hasColors) ? "has" : "doesn't have"
-	);
-
-	Logger::logMessageFormatted(
-		"This model %s per-vertex normals",
-		(hasNormals) ? "has" : "doesn't have"
-	);
-
-	std::vector<AttributeType> attributes
-	{
-		AttributeType::vec3
-	};
-
-	if (hasUV)		attributes.push_back(AttributeType::vec2);
-	if (hasNormals)	attributes.push_back(AttributeType::vec3);
-	if (hasColors)	attributes.push_back(AttributeType::vec3);
-
-	std::unordered_map<ObjVertex, uint32_t> uniqueVertices = {};
-	std::vector<ObjVertex> vertices = {};
-	std::vector<uint32_t> indices = {};
-
-	for (const auto &shape : shapes)
-		for (const auto &index : shape.mesh.indices) {
-			ObjVertex vertex
-			{
-				.pos
-				{
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				}
-			};
-
-			if (hasUV)
-			{
-				vertex.uv = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-			}
-
-			if (hasNormals)
-			{
-				vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2]
-				};
-			}
-
-			if (hasColors)
-			{
-				vertex.color = {
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2]
-				};
-			}
-
-			if (uniqueVertices.count(vertex) == 0) {
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
-
-			indices.push_back(uniqueVertices[vertex]);
-		}
-
-	OFile::FileData result
-	{
-		.attributes = std::move(attributes),
-		.vertexAmount = uniqueVertices.size(),
-		.indices = std::move(indices),
-	};
-
-	size_t kbWritten = 0;
-
-	if (hasUV && hasNormals && hasColors)
-	{
-		result.vertices.resize(vertices.size() * sizeof(ObjVertex));
-		memcpy(result.vertices.data(), vertices.data(), result.vertices.size());
-
-		kbWritten = result.vertices.size() / 1024;
-
-	}
-	else
-	{
-		std::vector<std::byte> vertexData = std::vector<std::byte>(vertices.size() * sizeof(ObjVertex));
-		StreamOut stream(vertexData.data(), vertexData.size());
-		for (auto &vertex : vertices)
-		{
-			stream.setNext(vertex.pos);
-			if (hasUV) stream.setNext(vertex.uv);
-			if (hasNormals) stream.setNext(vertex.normal);
-			if (hasColors) stream.setNext(vertex.color);
-		}
-
-		result.vertices = std::move(vertexData);
-		result.vertices.resize(stream.bytesWritten());
-
-		kbWritten = result.vertices.size() / 1024;
-	}
-
-	Logger::logMessageFormatted(
-		"%u individual vertices found, which take %u KB.",
-		uniqueVertices.size(),
-		kbWritten
-	);
-
-	return result;
-}
 
 int main(int argc, char *argv[])
 {
@@ -191,6 +18,15 @@ int main(int argc, char *argv[])
 
 	std::string inputPath = {};
 	std::string outputPath = {};
+	std::string batchInput = {};
+	std::string buildInput = {};
+	BuildTools buildTools = {};
+	size_t threadCount = ThreadPool::defaultWorkerCount() + 1;
+	std::string cachePath = {};
+	std::string benchmark = {};
+	bool verbose = false;
+	bool force = false;
+	CompileOptions options = {};
 
 	for (int i = 0; i < argc; i++)
 	{
@@ -207,37 +43,212 @@ int main(int argc, char *argv[])
 			if (i >= argc) break;
 			outputPath = std::string(argv[i]);
 		}
+		else if (argument.compare("-batch") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			batchInput = std::string(argv[i]);
+		}
+		else if (argument.compare("-build") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			buildInput = std::string(argv[i]);
+		}
+		else if (argument.compare("-glslang") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			buildTools.glslangValidator = std::string(argv[i]);
+		}
+		else if (argument.compare("-threads") == 0 || argument.compare("-j") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			threadCount = std::max(1, std::atoi(argv[i]));
+		}
+		else if (argument.compare("-cache") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			cachePath = std::string(argv[i]);
+		}
+		else if (argument.compare("-benchmark") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			benchmark = std::string(argv[i]);
+		}
+		else if (argument.compare("-lods") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			options.lodCount = (uint32_t)std::clamp(std::atoi(argv[i]), 0, 8);
+		}
+		else if (argument.compare("-lodError") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			options.lodError = std::max(0.0f, (float)std::atof(argv[i]));
+		}
+		else if (argument.compare("-compressionLevel") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			options.compressionLevel = std::clamp(std::atoi(argv[i]), 0, 12);
+		}
+		else if (argument.compare("-textureFormat") == 0)
+		{
+			i++;
+			if (i >= argc) break;
+			const std::string format = std::string(argv[i]);
+			if (format.compare("rgba8") == 0) options.textureFormat = TextureFormat::rgba8;
+			else if (format.compare("bc1") == 0) options.textureFormat = TextureFormat::bc1;
+			else if (format.compare("bc3") == 0) options.textureFormat = TextureFormat::bc3;
+			else if (format.compare("bc5") == 0) options.textureFormat = TextureFormat::bc5;
+			else if (format.compare("bc7") == 0) options.textureFormat = TextureFormat::bc7;
+			else Logger::logWarningFormatted("Unknown texture format %s, expected one of: rgba8, bc1, bc3, bc5, bc7", format.c_str());
+		}
+		else if (argument.compare("-linearTextures") == 0)
+		{
+			options.srgbTextures = false;
+		}
+		else if (argument.compare("-verbose") == 0)
+		{
+			verbose = true;
+		}
+		else if (argument.compare("-force") == 0)
+		{
+			force = true;
+		}
+		else if (argument.compare("-tinyobj") == 0)
+		{
+			options.streamingParser = false;
+		}
+		else if (argument.compare("-noOptimise") == 0)
+		{
+			options.optimise = false;
+		}
+		else if (argument.compare("-fullPrecision") == 0)
+		{
+			options.compactAttributes = false;
+		}
+		else if (argument.compare("-quantisePositions") == 0)
+		{
+			options.quantisePositions = true;
+		}
+		else if (argument.compare("-splitPositions") == 0)
+		{
+			options.splitPositions = true;
+		}
+		else if (argument.compare("-noGenerateNormals") == 0)
+		{
+			options.generateNormals = false;
+		}
+		else if (argument.compare("-recomputeNormals") == 0)
+		{
+			options.recomputeNormals = true;
+		}
+		else if (argument.compare("-tangents") == 0)
+		{
+			options.generateTangents = true;
+		}
+		else if (argument.compare("-meshlets") == 0)
+		{
+			options.meshlets = true;
+		}
 	}
 
-	if (inputPath.empty() || outputPath.empty())
+	if (benchmark.compare("cull") == 0) return benchmarkCull(1'000'000);
+	if (benchmark.compare("jobs") == 0) return benchmarkJobs(threadCount);
+
+	if (!benchmark.empty())
 	{
-		Logger::logError("Could not parse src and dst arguments - aborting");
+		RETURNCHECK(!inputPath.empty(), "Benchmarks need a -src model - aborting");
+		ThreadPool pool(threadCount - 1);
+
+		if (benchmark.compare("weld") == 0) return benchmarkWeld(inputPath, pool);
+		if (benchmark.compare("parse") == 0) return benchmarkParse(inputPath, pool);
+		if (benchmark.compare("load") == 0) return benchmarkLoad(inputPath, pool);
+
+		Logger::logErrorFormatted("Unknown benchmark %s, expected one of: weld, parse, load, cull, jobs", benchmark.c_str());
 		return -1;
 	}
 
-	RETURNCHECK(inputPath.ends_with(".obj"), "This asset compiler only parses .objs. Please provide an obj file!");
-	Logger::logMessageFormatted("----- Processing model at path: %s to destination %s -----", inputPath.c_str(), outputPath.c_str());
+	if (!buildInput.empty())
+	{
+		RETURNCHECK(!outputPath.empty(), "Build mode needs a -dst output directory - aborting");
+		if (cachePath.empty()) cachePath = (std::filesystem::path(outputPath) / ".ofilecache").string();
 
-	ObjAttribute attrib;
-	std::vector<ObjShape> shapes;
+		const BuildGraph graph = gatherBuildGraph(buildInput, outputPath);
+		RETURNCHECK(!graph.nodes.empty(), "Build input contains no shaders, .obj or image files - aborting");
+		Logger::logMessageFormatted("----- Building %zu assets from %s to %s with %zu jobs -----", graph.nodes.size(), buildInput.c_str(), outputPath.c_str(), threadCount);
 
-	const bool succeeded = loadObj(inputPath, attrib, shapes);
-	RETURNCHECK(succeeded, "Couldn't load .obj!");
+		if (!verbose) Logger::setVerbosity(Logger::Verbosity::WARNING);
 
-	RETURNCHECK(attrib.vertices.size() > 0, ("Model at " + std::string(inputPath) + " has no vertex positions!").c_str());
+		AssetCache cache(cachePath);
+		if (force) cache.clear();
+		const BuildReport report = runBuild(graph, options, buildTools, threadCount, cache);
 
-	std::cout << std::endl;
+		Logger::setVerbosity(Logger::Verbosity::TRIVIAL);
+		logBatchSummary(report.results, report.wallMilliseconds, threadCount);
+		logCriticalPath(graph, report);
+		if (!cache.save()) Logger::logWarningFormatted("Could not save the asset cache to %s", cachePath.c_str());
 
-	const auto processingResult = processObj(attrib, shapes);
+		const bool allSucceeded = std::all_of(report.results.begin(), report.results.end(), [](const CompileResult &result) { return result.succeeded; });
+		return allSucceeded ? 0 : -1;
+	}
 
-	if (OFile::save(outputPath.c_str(), processingResult))
+	if (!batchInput.empty())
 	{
-		Logger::logMessage("File was outputed successfully!");
-		return 0;
+		RETURNCHECK(!outputPath.empty(), "Batch mode needs a -dst output directory - aborting");
+		if (cachePath.empty()) cachePath = (std::filesystem::path(outputPath) / ".ofilecache").string();
+
+		const std::vector<BatchJob> jobs = gatherBatchJobs(batchInput, outputPath);
+		RETURNCHECK(!jobs.empty(), "Batch input contains no .obj or image files - aborting");
+		Logger::logMessageFormatted("----- Compiling %zu assets from %s to %s on %zu threads -----", jobs.size(), batchInput.c_str(), outputPath.c_str(), threadCount);
+
+		//per-model messages from every worker would just be noise, the summary covers them
+		if (!verbose) Logger::setVerbosity(Logger::Verbosity::WARNING);
+
+		//-force still records into the cache, so the next incremental run starts from a clean slate
+		AssetCache cache(cachePath);
+		if (force) cache.clear();
+		ThreadPool pool(threadCount - 1);
+		const auto start = std::chrono::steady_clock::now();
+		const std::vector<CompileResult> results = compileBatch(jobs, options, pool, &cache);
+		const float wallMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		Logger::setVerbosity(Logger::Verbosity::TRIVIAL);
+		logBatchSummary(results, wallMilliseconds, threadCount);
+		if (!cache.save()) Logger::logWarningFormatted("Could not save the asset cache to %s", cachePath.c_str());
+
+		const bool allSucceeded = std::all_of(results.begin(), results.end(), [](const CompileResult &result) { return result.succeeded; });
+		return allSucceeded ? 0 : -1;
 	}
-	else
+
+	if (inputPath.empty() || outputPath.empty())
 	{
-		Logger::logError("File could not be written to!");
+		Logger::logError("Could not parse src and dst arguments - aborting");
 		return -1;
 	}
-}
\ No newline at end of file
+
+	Logger::logMessageFormatted("----- Processing asset at path: %s to destination %s -----", inputPath.c_str(), outputPath.c_str());
+
+	if (cachePath.empty()) cachePath = (std::filesystem::path(outputPath).parent_path() / ".ofilecache").string();
+	AssetCache cache(cachePath);
+	if (force) cache.forget(outputPath); //the cache is shared with the rest of the directory, only this asset is rebuilt
+	ThreadPool pool(threadCount - 1);
+	const CompileResult result = compileAssetCached(inputPath, outputPath, options, cache, &pool);
+	RETURNCHECK(result.succeeded, "Couldn't compile asset!");
+	if (!cache.save()) Logger::logWarningFormatted("Could not save the asset cache to %s", cachePath.c_str());
+
+	if (result.upToDate)
+	{
+		Logger::logMessage("File is up to date, skipping");
+		return 0;
+	}
+
+	Logger::logMessageFormatted("File was outputed successfully in %.2f ms!", result.milliseconds);
+	return 0;
+}
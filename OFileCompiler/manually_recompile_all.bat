@@ -1,18 +1,5 @@
-REM go to the raw shaders directory
-cd ..\raw_assets\shaders
-
-REM iterate over all vertex, fragment and compute shaders
-for %%i in (*.vert *.frag *.comp) do (
-      ..\..\Dependencies\bin\glslangValidator.exe -V "%%~fi" -o "..\..\_assets\shaders\%%~nxi.spv"
-)
-
-REM go to the raw meshes folder
-cd ..\models
-
-REM iterate over all .obj meshes
-for %%j in (*.obj) do (
-       REM compile the .obj file into a .o
-       ..\..\OFileCompiler\build\OFileCompiler.exe -src "%%~fj"  -dst "..\..\_assets\models\%%~nj.o"
-)
+REM build every shader, model and texture under raw_assets whose output is out of date, as many at once as there are cores
+REM add -force to rebuild everything, and -j to limit how many run at once
+build\OFileCompiler.exe -build "..\raw_assets" -dst "..\_assets" -glslang "..\Dependencies\bin\glslangValidator.exe"
 
 pause
\ No newline at end of file
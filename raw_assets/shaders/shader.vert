@@ -8,6 +8,8 @@ layout (location = 1) in vec3 vUV;
 layout (location = 2) in vec3 vNormal;
 layout (location = 3) in vec3 vColor;
 
+layout (constant_id = 0) const bool octahedralNormals = false;
+
 layout (location = 0) out vec3 outColor;
 layout (location = 1) out vec3 outUV;
 
@@ -32,12 +34,23 @@ layout(std140,set = 1, binding = 0) readonly buffer ObjectBuffer
 
 
 
+//inverse of the compiler's quantise::toOctahedral16, the snorm format already mapped xy back to [-1, 1]
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0);
+	normal.x += normal.x >= 0.0 ? -fold : fold;
+	normal.y += normal.y >= 0.0 ? -fold : fold;
+	return normalize(normal);
+}
+
 void main() 
 {
-	ObjectData objectData = objectBuffer.objects[gl_BaseInstance];
+	ObjectData objectData = objectBuffer.objects[gl_InstanceIndex]; //firstInstance plus the instance, so an instanced draw walks a range of objects
 	mat4 modelMatrix = objectData.model;
 	mat4 transformMatrix = (camera.viewproj * modelMatrix);
 	gl_Position = transformMatrix * vec4(vPosition, 1.0);
-	outColor = objectData.color.xyz * dot(vNormal, vec3(1.0,.0,.0));
+	vec3 normal = octahedralNormals ? decodeOctahedral(vNormal.xy) : vNormal;
+	outColor = objectData.color.xyz * dot(normal, vec3(1.0,.0,.0));
 	outUV = vUV;
 }
\ No newline at end of file